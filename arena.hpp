@@ -0,0 +1,77 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// SECTION : ARENA ALLOCATOR
+//-----------------------------------------------------------------------------------------------------------------------------
+
+// CLASS : Arena
+// - bump allocator, memory is only given back when the arena itself is destroyed
+// - objects placed in the arena never have their destructors run, so they must not own heap memory
+class Arena{
+private:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char* current = nullptr;
+    size_t remaining = 0;
+    size_t used = 0;
+
+    void grow(size_t size){
+        size_t blockSize = size > BLOCK_SIZE ? size : BLOCK_SIZE;
+        blocks.emplace_back(new char[blockSize]);
+        current = blocks.back().get();
+        remaining = blockSize;
+    }
+
+public:
+    Arena() = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // Method to allocate raw, aligned memory
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t)){
+        size_t padding = (alignment - reinterpret_cast<uintptr_t>(current) % alignment) % alignment;
+        if(current == nullptr || padding + size > remaining){
+            grow(size + alignment);
+            padding = (alignment - reinterpret_cast<uintptr_t>(current) % alignment) % alignment;
+        }
+        char* result = current + padding;
+        current += padding + size;
+        remaining -= padding + size;
+        used += size;
+        return result;
+    }
+
+    // Method to construct an object in the arena
+    template <typename T, typename... Args>
+    T* make(Args&&... args){
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    // Method to copy a string into the arena
+    std::string_view copy(std::string_view text){
+        if(text.empty()){
+            return std::string_view();
+        }
+        char* data = static_cast<char*>(allocate(text.size(), 1));
+        std::memcpy(data, text.data(), text.size());
+        return std::string_view(data, text.size());
+    }
+
+    // Bytes handed out so far
+    size_t bytes_used() const {
+        return used;
+    }
+};
+
+#endif // ARENA_HPP
@@ -1,17 +1,24 @@
 #ifndef AST_HPP
 #define AST_HPP
 
+#include <algorithm>
+#include <cstdint>
 #include <iostream>
+#include <stdexcept>
 #include <string>
-#include <list>
-#include <stack>
-#include <queue>
+#include <string_view>
+#include <vector>
+
+#include "intern.hpp"
 
 //-----------------------------------------------------------------------------------------------------------------------------
-// SECTION : ABSTRACT SYNTAX TREE                                                              
+// SECTION : ABSTRACT SYNTAX TREE
+// - a struct-of-arrays node table: a node is an index into every column, and refers to its children by their indices
+// - children are added before their parent, the parser builds the table bottom up
+// - passes walk it with a switch on the kind column, there are no node classes and no virtual calls
 //-----------------------------------------------------------------------------------------------------------------------------
 
-enum class AST_type{
+enum class AST_type : uint8_t{
     INTEGER,
     CHAR,
     STRING,
@@ -28,462 +35,423 @@ enum class AST_type{
     BLOCK,
 };
 
-// RESULT TYPE
-enum class res_type{
-    INTEGER, CHAR, STRING, FLOAT, BOOLEAN, VOID,
-    VAR_INTEGER, VAR_CHAR, VAR_STRING, VAR_FLOAT, VAR_BOOLEAN, VAR_UNKNOWN,
+// OPERATORS
+// - named after how they are spelled, + and - are also the unary ones
+#define ION_AST_OPS(X) \
+    X(NONE,          "")   \
+    X(ASSIGN,        "=")  \
+    X(PLUS,          "+")  \
+    X(MINUS,         "-")  \
+    X(TIMES,         "*")  \
+    X(DIVIDE,        "/")  \
+    X(MODULO,        "%")  \
+    X(EQUAL,         "==") \
+    X(NOT_EQUAL,     "!=") \
+    X(LESS,          "<")  \
+    X(LESS_EQUAL,    "<=") \
+    X(GREATER,       ">")  \
+    X(GREATER_EQUAL, ">=") \
+    X(AND,           "&&") \
+    X(OR,            "||") \
+    X(NOT,           "!")  \
+    X(BIT_AND,       "&")  \
+    X(BIT_OR,        "|")
+
+enum class AST_op : uint8_t {
+#define ION_AST_ENUM(name, text) name,
+    ION_AST_OPS(ION_AST_ENUM)
+#undef ION_AST_ENUM
 };
 
-// Print result type
-std::ostream& operator<<(std::ostream& os, res_type type) {
-    switch (type) {
-        case res_type::INTEGER:
-            os << "INTEGER";
-            break;
-        case res_type::CHAR:
-            os << "CHAR";
-            break;
-        case res_type::STRING:
-            os << "STRING";
-            break;
-        case res_type::BOOLEAN:
-            os << "BOOLEAN";
-            break;
-        case res_type::FLOAT:
-            os << "FLOAT";
-            break;
-        case res_type::VOID:
-            os << "VOID";
-            break;
-        case res_type::VAR_INTEGER:
-            os << "VAR_INTEGER";
-            break;
-        case res_type::VAR_CHAR:
-            os << "VAR_CHAR";
-            break;
-        case res_type::VAR_STRING:
-            os << "VAR_STRING";
-            break;
-        case res_type::VAR_BOOLEAN:
-            os << "VAR_BOOLEAN";
-            break;
-        case res_type::VAR_FLOAT:
-            os << "VAR_FLOAT";
-            break;
-        case res_type::VAR_UNKNOWN:
-            os << "VAR_UNKNOWN";
-            break;
+std::string_view ast_op_name(AST_op op){
+    static const std::string_view names[] = {
+#define ION_AST_NAME(name, text) text,
+        ION_AST_OPS(ION_AST_NAME)
+#undef ION_AST_NAME
+    };
+    return names[(int)op];
+}
+
+// Function to get the operator a lexeme spells
+AST_op ast_op_of(std::string_view lexeme){
+    for(int op = (int)AST_op::ASSIGN; op <= (int)AST_op::BIT_OR; op++){
+        if(ast_op_name((AST_op)op) == lexeme){
+            return (AST_op)op;
+        }
     }
-    return os;
+    throw std::runtime_error("Unknown operator " + std::string(lexeme));
 }
 
-// RESULT
-// - data struct that is returned by code generate
-struct codeGenResult{
-    std::string registerName;  // The name of the register holding the result
-    res_type type;            // The data type of the result
-};
+inline bool is_comparison(AST_op op){
+    return op >= AST_op::EQUAL && op <= AST_op::GREATER_EQUAL;
+}
+
+// Symbol table types filled in by the parser and the resolver (table.hpp)
+class Table;
+struct metadata;
 
 // FUNCTION : indentation printing
 // - prints the indentation for DEBUGGING purposes only
-void print_indent(int indent){
+void print_indent(std::ostream& os, int indent){
     for(int i = 0; i < indent; i++){
-        std::cout << "      ";
+        os << "      ";
     }
 }
 
-// BASE CLASS
-class AST_expression{
-public:
-    AST_type type;
-    AST_expression(AST_type type) : type(type) {}
-    virtual ~AST_expression() = default;
-    virtual void print (int) const = 0;
-    virtual codeGenResult generate_code() = 0;
-};
+// Index of a node in its program
+using node_id = uint32_t;
 
-//  DERIVED CLASS : Integer
-//  - Stores an integer literal
-class AST_integer : public AST_expression{
-public:
-    int value;
-    AST_integer(int val) : AST_expression(AST_type::INTEGER) {
-        this->value = val;
-    }
+const node_id NO_NODE = UINT32_MAX;
 
-    void print(int indent) const {
-        print_indent(indent);
-        std::cout << "Integer: " << value;
-        std::cout << std::endl;
-    }
-
-    codeGenResult generate_code();
+// LIST OF NODES
+// - the children of a node with any number of them, a range of the program's lists
+struct AST_list{
+    const node_id* first;
+    uint32_t count;
 
-    ~AST_integer(){}
+    const node_id* begin() const { return first; }
+    const node_id* end() const { return first + count; }
+    node_id operator[](uint32_t i) const { return first[i]; }
+    uint32_t size() const { return count; }
 };
 
-//  DERIVED CLASS : Boolean
-//  - Stores a boolean
-class AST_boolean : public AST_expression{
+// CLASS : Program
+// - the node table of a whole program, with the lists and pools its columns point into
+// - the meaning of a, b and c depends on the kind of the node:
+//      INTEGER         a = index into integers
+//      FLOAT           a = index into floats
+//      BOOLEAN, CHAR   a = value
+//      STRING          a = symbol of the literal
+//      VARIABLE        a = name, b = frame offset and c = index into variables, both set by the resolver
+//      UNARY           a = operand
+//      BINARY          a = LHS, b = RHS
+//      BLOCK           a = index into scopes, b = first child in lists, c = child count
+//      CONDITIONAL     b = first branch in lists, c = branch count, a branch is a condition (NO_NODE for else) and a body
+//      LOOP            a = condition, b = body
+//      FUNCTION        a = name, b = first parameter in lists, c = parameter count, the body follows the parameters
+//      FUNCTION_CALL   a = name, b = first argument in lists, c = argument count
+//      RETURN          a = expression
+// - a function's body has the function's scope, which holds the parameters
+class AST_program {
 public:
-    bool value;
-    AST_boolean(bool value) : AST_expression(AST_type::BOOLEAN) {
-        this->value = value;
-    }
+    static const uint32_t NO_VARIABLE = UINT32_MAX;
 
-    void print(int indent) const {
-        print_indent(indent);
-        std::cout << "Boolean: " << (value ? "true" : "false");
-        std::cout << std::endl;
-    }
+    // Node table
+    std::vector<AST_type> kinds;
+    std::vector<AST_op> ops;                // operator of unary and binary nodes
+    std::vector<uint32_t> a, b, c;
+    std::vector<uint8_t> effects;           // assigns or calls somewhere below, so it keeps its place in evaluation order
+    std::vector<uint16_t> registers;        // registers its code needs, the Sethi-Ullman number of the subtree
 
-    codeGenResult generate_code();
+    std::vector<node_id> lists;             // children of blocks, conditionals, functions and calls
+    std::vector<int32_t> integers;          // literal pool
+    std::vector<float> floats;
+    std::vector<Table*> scopes;             // scope of each block
+    std::vector<metadata*> variables;       // symbol table entry of each variable, in the order they are declared
 
-    ~AST_boolean(){}
-};
+    std::vector<node_id> expressions;       // top level, in order
 
-//  DERIVED CLASS : Float
-//  - Stores a float literal
-class AST_float : public AST_expression{
-public: 
-    float value;
-    AST_float(float value) : AST_expression(AST_type::FLOAT){
-        this->value = value;
-    }
+    AST_program() = default;
+    AST_program(const AST_program&) = delete;
+    AST_program& operator=(const AST_program&) = delete;
 
-    void print(int indent) const {
-        print_indent(indent);
-        std::cout << "Float: " << value;
-        std::cout << std::endl;
+    size_t size() const {
+        return kinds.size();
     }
 
-    codeGenResult generate_code();
-
-    ~AST_float(){}
-};
-
-//  DERIVED CLASS : Char
-//  - Stores a char literal
-class AST_char : public AST_expression{
-public:
-    char value;
-    AST_char(char value) : AST_expression(AST_type::CHAR){
-        this->value = value;
+    // Method to make room for n nodes, a program has at most as many nodes as tokens
+    void reserve(size_t n){
+        kinds.reserve(n);
+        ops.reserve(n);
+        a.reserve(n);
+        b.reserve(n);
+        c.reserve(n);
+        effects.reserve(n);
+        registers.reserve(n);
     }
 
-    void print(int indent) const {
-        print_indent(indent);
-        std::cout << "Char: '" << value;
-        std::cout << std::endl;
+    // Bytes held by the table, the lists and the pools
+    size_t bytes_used() const {
+        return kinds.capacity() * sizeof(AST_type) + ops.capacity() * sizeof(AST_op)
+            + (a.capacity() + b.capacity() + c.capacity()) * sizeof(uint32_t)
+            + effects.capacity() * sizeof(uint8_t) + registers.capacity() * sizeof(uint16_t)
+            + lists.capacity() * sizeof(node_id) + integers.capacity() * sizeof(int32_t) + floats.capacity() * sizeof(float)
+            + (scopes.capacity() + variables.capacity()) * sizeof(void*) + expressions.capacity() * sizeof(node_id);
     }
 
-    codeGenResult generate_code();
+    //-------------------------------------------------------------------------------------------------------------------------
+    // Reading nodes
 
-    ~AST_char(){}
-};
+    AST_type type(node_id n) const { return kinds[n]; }
+    AST_op op(node_id n) const { return ops[n]; }
 
-// DERIVED CLASS : String
-// - Stores a string literal
-class AST_string : public AST_expression{
-public:
-    std::string value;
-    AST_string(std::string val) : AST_expression(AST_type::STRING) {
-        this->value = val;
-    }
+    int32_t integer(node_id n) const { return integers[a[n]]; }
+    float floating(node_id n) const { return floats[a[n]]; }
+    bool boolean(node_id n) const { return a[n] != 0; }
+    char character(node_id n) const { return (char)a[n]; }
+    symbol_id string(node_id n) const { return a[n]; }
 
-    void print(int indent) const {
-        print_indent(indent);
-        std::cout << "String: \"" << value << "\"";
-        std::cout << std::endl;
-    }
+    // name of a variable, function or call
+    symbol_id name(node_id n) const { return a[n]; }
 
-    codeGenResult generate_code();
+    // symbol table entry and frame offset of a resolved variable, no entry before the resolver ran
+    metadata* variable(node_id n) const { return c[n] != NO_VARIABLE ? variables[c[n]] : nullptr; }
+    int offset(node_id n) const { return (int32_t)b[n]; }
 
-    ~AST_string(){}
-};
+    node_id operand(node_id n) const { return a[n]; }       // unary, return
+    node_id lhs(node_id n) const { return a[n]; }
+    node_id rhs(node_id n) const { return b[n]; }
 
-//  DERIVED CLASS : Variable
-//  - Stores a variable name
-class AST_variable : public AST_expression{
-public:
-    std::string name;
-    AST_variable(std::string name) : AST_expression(AST_type::VARIABLE) {
-        this->name = name;
-    }
+    // children of a block, parameters of a function, arguments of a call
+    AST_list list(node_id n) const { return AST_list{lists.data() + b[n], c[n]}; }
 
-    void print(int indent) const {
-        print_indent(indent);
-        std::cout << "Variable: " << name;
-        std::cout << std::endl;
-    }
+    Table* scope(node_id n) const { return scopes[a[n]]; }
 
-    codeGenResult generate_code();
-
-    ~AST_variable(){}
-};
+    node_id condition(node_id n) const { return a[n]; }     // loop
+    node_id body(node_id n) const { return kinds[n] == AST_type::LOOP ? b[n] : lists[b[n] + c[n]]; }
 
-//  DERIVED CLASS : Unary
-//  - Stores an operator and an operand
-class AST_unary : public AST_expression{
-public:
-    std::string op;
-    AST_expression *expr;
+    uint32_t branches(node_id n) const { return c[n]; }
+    node_id condition(node_id n, uint32_t branch) const { return lists[b[n] + 2 * branch]; }
+    node_id body(node_id n, uint32_t branch) const { return lists[b[n] + 2 * branch + 1]; }
 
-    AST_unary(): AST_expression(AST_type::UNARY){}
+    //-------------------------------------------------------------------------------------------------------------------------
+    // Building nodes
+    // - lists are collected on pending while their nodes are parsed, begin_list marks where one starts
 
-    AST_unary(std::string op, AST_expression* expr): AST_expression(AST_type::UNARY){
-        this->op = op;
-        this->expr = expr;
+    node_id add_integer(int32_t value){
+        integers.push_back(value);
+        return add(AST_type::INTEGER, (uint32_t)integers.size() - 1);
     }
 
-    void print(int indent) const {
-        print_indent(indent);
-        std::cout << "Unary Expression: " << std::endl;
-        print_indent(indent + 1);
-        std::cout << op << std::endl;
-        expr->print(indent + 1);
+    node_id add_float(float value){
+        floats.push_back(value);
+        return add(AST_type::FLOAT, (uint32_t)floats.size() - 1);
     }
-    
-    codeGenResult generate_code();
-
-    ~AST_unary(){}
-};
 
-//  DERIVED CLASS : Binary
-//  - Stores an operator and two operands
-class AST_binary : public AST_expression{
-public:
-    std::string op;
-    AST_expression *LHS, *RHS;
-
-    AST_binary(): AST_expression(AST_type::BINARY){}
+    node_id add_boolean(bool value){ return add(AST_type::BOOLEAN, value ? 1 : 0); }
+    node_id add_char(char value){ return add(AST_type::CHAR, (unsigned char)value); }
+    node_id add_string(symbol_id literal){ return add(AST_type::STRING, literal); }
+    node_id add_variable(symbol_id name){ return add(AST_type::VARIABLE, name, 0, NO_VARIABLE); }
 
-    AST_binary(std::string op, AST_expression* LHS, AST_expression* RHS): AST_expression(AST_type::BINARY){
-        this->LHS = LHS;
-        this->RHS = RHS;
-        this->op = op;
-    }
+    node_id add_unary(AST_op op, node_id operand){ return add(AST_type::UNARY, operand, 0, 0, op); }
+    node_id add_binary(AST_op op, node_id lhs, node_id rhs){ return add(AST_type::BINARY, lhs, rhs, 0, op); }
+    node_id add_loop(node_id condition, node_id body){ return add(AST_type::LOOP, condition, body); }
+    node_id add_return(node_id expr){ return add(AST_type::RETURN, expr); }
 
-    void print(int indent) const {
-        print_indent(indent);
-        std::cout << "Binary Expression: " << std::endl;
-        LHS->print(indent + 1);
-        print_indent(indent + 1);
-        std::cout << op << std::endl;
-        RHS->print(indent + 1);
+    uint32_t begin_list() const {
+        return (uint32_t)pending.size();
     }
 
-    codeGenResult generate_code();
-
-    ~AST_binary(){}
-};
-
-//  DERIVED CLASS : Block
-//  - Stores a list of expressions
-class AST_block : public AST_expression{
-public:
-    std::list <AST_expression*> children;
-
-    AST_block() : AST_expression(AST_type::BLOCK) {}
-
-    void addChild(AST_expression* expr){
-        this->children.push_back(expr);
+    void push(node_id n){
+        pending.push_back(n);
     }
 
-    void print(int indent) const {
-        print_indent(indent);
-        std::cout << "Block: {" << std::endl;
-        for (auto expr : children) {
-            expr->print(indent + 1);
-        }
-        print_indent(indent);
-        std::cout << "}" << std::endl;
+    node_id add_block(uint32_t list, Table* scope){
+        scopes.push_back(scope);
+        uint32_t first = end_list(list);
+        return add(AST_type::BLOCK, (uint32_t)scopes.size() - 1, first, (uint32_t)lists.size() - first);
     }
 
-    codeGenResult generate_code();
-
-    ~AST_block(){};
-};
-
-//  DERIVED CLASS : Conditional
-//  - Stores a list of branches
-class AST_conditional : public AST_expression{
-private:
-    struct branch{
-        AST_expression *condition;
-        AST_block *body;
-    };
-public:
-    std::list <branch> branches;
-
-    AST_conditional() : AST_expression(AST_type::CONDITIONAL) {}
-
-    void addBranch(AST_expression* condition, AST_block* body){
-        branch b;
-        b.condition = condition;
-        b.body = body;
-        this->branches.push_back(b);
+    // the list holds a condition, or NO_NODE, and a body for each branch
+    node_id add_conditional(uint32_t list){
+        uint32_t first = end_list(list);
+        return add(AST_type::CONDITIONAL, 0, first, ((uint32_t)lists.size() - first) / 2);
     }
 
-    void print(int indent) const {
-        print_indent(indent);
-        std::cout << "Conditional: {" << std::endl;
-        for (const auto &branch : branches) {
-            print_indent(indent+1);
-
-            std::cout << "Condition: " << std::endl;
-            if(branch.condition != nullptr){
-                branch.condition->print(indent + 1);
-            }else{
-                print_indent(indent + 2);
-                std::cout << "None" << std::endl;
-            }
-
-            print_indent(indent+1);
-            std::cout << "Body: " <<std::endl;
-            branch.body->print(indent + 2);
-        }
-        print_indent(indent);
-        std::cout << "}" << std::endl;
+    // the list holds the parameters, then the body
+    node_id add_function(symbol_id name, uint32_t list){
+        uint32_t first = end_list(list);
+        return add(AST_type::FUNCTION, name, first, (uint32_t)lists.size() - first - 1);
     }
-    
-    codeGenResult generate_code();
-
-    ~AST_conditional(){}
-};
 
-//  DERIVED CLASS : Loop
-//  - Stores condition and a body
-class AST_loop : public AST_expression{
-public:
-    AST_expression *condition;
-    AST_block *body;
-
-    AST_loop() : AST_expression(AST_type::LOOP) {}
-
-    void print(int indent) const {
-        print_indent(indent);
-        std::cout << "Loop: {" << std::endl;
-        print_indent(indent);
-        std::cout << "Condition: " << std::endl;
-        condition->print(indent + 1);
-        print_indent(indent);
-        std::cout << "Body: " << std::endl;
-        body->print(indent + 1);
-        print_indent(indent);
-        std::cout << "}" << std::endl;
+    node_id add_call(symbol_id name, uint32_t list){
+        uint32_t first = end_list(list);
+        return add(AST_type::FUNCTION_CALL, name, first, (uint32_t)lists.size() - first);
     }
 
-    codeGenResult generate_code();
-
-    ~AST_loop(){}
-};
+    //-------------------------------------------------------------------------------------------------------------------------
+    // Changing nodes, for the passes after the parser
 
-//  DERIVED CLASS : Function
-//  - Stores a list of parameters and a body
-class AST_function : public AST_expression{
-public:
-    std::string name;
-    std::list <AST_expression*> parameters;
-    AST_block *body;
-
-    AST_function(std::string name) : AST_expression(AST_type::FUNCTION) {
-        this->name = name;
+    void set_variable(node_id n, int offset, uint32_t variable){
+        b[n] = (uint32_t)offset;
+        c[n] = variable;
     }
 
-    void addParameter(AST_expression* param){
-        this->parameters.push_back(param);
+    // a node turned into a literal leaves its children unreferenced
+    void set_integer(node_id n, int32_t value){
+        integers.push_back(value);
+        set(n, AST_type::INTEGER, (uint32_t)integers.size() - 1);
     }
 
-    void setBody(AST_block* body){
-        this->body = body;
+    void set_boolean(node_id n, bool value){
+        set(n, AST_type::BOOLEAN, value ? 1 : 0);
     }
 
-    void print(int indent) const {
-        print_indent(indent);
-        std::cout << "Function: " << name << "(" << std::endl;
-        for (auto param : parameters) {
-            param->print(indent+1);
+    // Method to take the register need and side effects from the children, again whenever one of them is replaced
+    // - the result of a binary reuses the register of the side done first, which is the hungrier one
+    // - with sides that need as many, the first one's value is held while the second needs all of its own
+    void measure(node_id n){
+        switch(kinds[n]){
+            case AST_type::UNARY:
+                effects[n] = effects[a[n]];
+                registers[n] = registers[a[n]];
+                break;
+            case AST_type::BINARY: {
+                uint16_t lhs = registers[a[n]], rhs = registers[b[n]];
+                effects[n] = ops[n] == AST_op::ASSIGN || effects[a[n]] || effects[b[n]];
+                registers[n] = lhs == rhs ? lhs + 1 : std::max(lhs, rhs);
+                break;
+            }
+            case AST_type::FUNCTION_CALL:
+                effects[n] = 1;
+                registers[n] = 1;
+                break;
+            default:
+                effects[n] = 0;
+                registers[n] = 1;
+                break;
         }
-        print_indent(indent);
-        std::cout << ") {" << std::endl;
-        body->print(indent + 1);
-        print_indent(indent);
-        std::cout << "}" << std::endl;
     }
 
-    codeGenResult generate_code();
-
-    ~AST_function(){}
-};
+    //-------------------------------------------------------------------------------------------------------------------------
+    // Printing
 
-// DERIVED CLASS : Function call
-// - Stores a list of parameters and function's name
-class AST_function_call : public AST_expression{
-public:
-    std::string function_name;
-    std::list <AST_expression*> parameters;
-    AST_function_call(std::string name, std::list <AST_expression*> parameters) : AST_expression(AST_type::FUNCTION_CALL){
-        this->function_name = name;
-        this->parameters = parameters;
-    }
-
-    void print(int indent) const {
-        print_indent(indent);
-        std::cout << "Function Call: " << function_name << "(" << std::endl;
-        for (auto param : parameters) {
-            param->print(indent+1);
+    void print(std::ostream& os) const {
+        os << "Program: {\n";
+        for(node_id expr : expressions){
+            print(os, expr, 1);
         }
-        print_indent(indent);
-        std::cout << ")" << std::endl;
-    }
-    
-    codeGenResult generate_code();
-    
-    ~AST_function_call(){}
-};
-
-// DERIVED CLASS : Return
-// - Stores an expression to be returned
-class AST_return : public AST_expression{
-public:
-    AST_expression *expr;
-    AST_return(AST_expression* expr) : AST_expression(AST_type::RETURN){
-        this->expr = expr;
-    }
-
-    void print(int indent) const {
-        print_indent(indent);
-        std::cout << "Return: " << std::endl;
-        expr->print(indent + 1);
-    }
-
-    codeGenResult generate_code();
-
-    ~AST_return(){}
-};
-
-
-// CLASS : Program
-// - Stores a list of expressions
-class AST_program {
-public:
-    std::list <AST_expression*> expressions;
-    AST_program(){}
-    void addExpression (AST_expression* expr){
-        this->expressions.push_back(expr);
-    }
-
-    void print() const {
-        std::cout << "Program: {" << std::endl;
-        for (auto expr : expressions) {
-            expr->print(1);
+        os << "}\n";
+    }
+
+    void print(std::ostream& os, node_id n, int indent) const {
+        print_indent(os, indent);
+        switch(kinds[n]){
+            case AST_type::INTEGER:
+                os << "Integer: " << integer(n) << '\n';
+                break;
+            case AST_type::BOOLEAN:
+                os << "Boolean: " << (boolean(n) ? "true" : "false") << '\n';
+                break;
+            case AST_type::FLOAT:
+                os << "Float: " << floating(n) << '\n';
+                break;
+            case AST_type::CHAR:
+                os << "Char: '" << character(n) << '\n';
+                break;
+            case AST_type::STRING:
+                os << "String: \"" << SYMBOLS->name(string(n)) << "\"\n";
+                break;
+            case AST_type::VARIABLE:
+                os << "Variable: " << SYMBOLS->name(name(n)) << '\n';
+                break;
+            case AST_type::UNARY:
+                os << "Unary Expression: \n";
+                print_indent(os, indent + 1);
+                os << ast_op_name(op(n)) << '\n';
+                print(os, operand(n), indent + 1);
+                break;
+            case AST_type::BINARY:
+                os << "Binary Expression: \n";
+                print(os, lhs(n), indent + 1);
+                print_indent(os, indent + 1);
+                os << ast_op_name(op(n)) << '\n';
+                print(os, rhs(n), indent + 1);
+                break;
+            case AST_type::BLOCK:
+                os << "Block: {\n";
+                for(node_id child : list(n)){
+                    print(os, child, indent + 1);
+                }
+                print_indent(os, indent);
+                os << "}\n";
+                break;
+            case AST_type::CONDITIONAL:
+                os << "Conditional: {\n";
+                for(uint32_t i = 0; i < branches(n); i++){
+                    print_indent(os, indent + 1);
+                    os << "Condition: \n";
+                    if(condition(n, i) != NO_NODE){
+                        print(os, condition(n, i), indent + 1);
+                    }else{
+                        print_indent(os, indent + 2);
+                        os << "None\n";
+                    }
+                    print_indent(os, indent + 1);
+                    os << "Body: \n";
+                    print(os, body(n, i), indent + 2);
+                }
+                print_indent(os, indent);
+                os << "}\n";
+                break;
+            case AST_type::LOOP:
+                os << "Loop: {\n";
+                print_indent(os, indent);
+                os << "Condition: \n";
+                print(os, condition(n), indent + 1);
+                print_indent(os, indent);
+                os << "Body: \n";
+                print(os, body(n), indent + 1);
+                print_indent(os, indent);
+                os << "}\n";
+                break;
+            case AST_type::FUNCTION:
+                os << "Function: " << SYMBOLS->name(name(n)) << "(\n";
+                for(node_id param : list(n)){
+                    print(os, param, indent + 1);
+                }
+                print_indent(os, indent);
+                os << ") {\n";
+                print(os, body(n), indent + 1);
+                print_indent(os, indent);
+                os << "}\n";
+                break;
+            case AST_type::FUNCTION_CALL:
+                os << "Function Call: " << SYMBOLS->name(name(n)) << "(\n";
+                for(node_id param : list(n)){
+                    print(os, param, indent + 1);
+                }
+                print_indent(os, indent);
+                os << ")\n";
+                break;
+            case AST_type::RETURN:
+                os << "Return: \n";
+                print(os, operand(n), indent + 1);
+                break;
         }
-        std::cout << "}" << std::endl;
     }
 
-    ~AST_program(){}
+private:
+    std::vector<node_id> pending;           // lists still being parsed, innermost last
+
+    node_id add(AST_type kind, uint32_t opA = 0, uint32_t opB = 0, uint32_t opC = 0, AST_op op = AST_op::NONE){
+        kinds.push_back(kind);
+        ops.push_back(op);
+        a.push_back(opA);
+        b.push_back(opB);
+        c.push_back(opC);
+        effects.push_back(0);
+        registers.push_back(1);
+        node_id n = (node_id)kinds.size() - 1;
+        measure(n);
+        return n;
+    }
+
+    void set(node_id n, AST_type kind, uint32_t opA){
+        kinds[n] = kind;
+        ops[n] = AST_op::NONE;
+        a[n] = opA;
+        measure(n);
+    }
+
+    // Method to move the nodes pending since a list began into lists, returns where they start
+    uint32_t end_list(uint32_t list){
+        uint32_t first = (uint32_t)lists.size();
+        lists.insert(lists.end(), pending.begin() + list, pending.end());
+        pending.resize(list);
+        return first;
+    }
 };
 
 
-#endif // AST_HPP
\ No newline at end of file
+#endif // AST_HPP
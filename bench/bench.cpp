@@ -0,0 +1,307 @@
+// Compiler benchmark
+// - generates synthetic .ion programs that scale with --scale and times the lexer, parser and code generator
+//   separately, through get_token, parse_program and generate_code
+// - compares the times against a stored baseline and exits with 1 if a phase got slower than the tolerance
+// - every scenario's times are taken relative to a reference workload, timed just before them, that does not touch the
+//   compiler, so a baseline from a faster or slower machine still compares and so do runs on a machine whose speed drifts
+// - that does not make up for a different cache or compiler, the baseline is best recorded on the machine that compares
+// - build: g++ -std=c++17 -O2 -pthread -o ion_bench bench/bench.cpp
+// - usage: ion_bench [--scale N] [--reps N] [--baseline FILE] [--tolerance PERCENT] [--update-baseline]
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../compiler.hpp"
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// SECTION : PROGRAM GENERATOR
+//-----------------------------------------------------------------------------------------------------------------------------
+
+// many top-level declarations with short expressions
+std::string generate_lets(int count){
+    std::string code;
+    for(int i = 0; i < count; i++){
+        code += "let v" + std::to_string(i) + ": int = " + std::to_string(i) + " + " + std::to_string(i) + " * 3\n";
+    }
+    return code;
+}
+
+// long expressions, each declaration has terms operators of mixed precedence
+std::string generate_expressions(int count, int terms){
+    static const char* ops[] = {" + ", " * ", " - ", " / "};
+    std::string code;
+    for(int i = 0; i < count; i++){
+        code += "let e" + std::to_string(i) + ": int = 1";
+        for(int t = 1; t < terms; t++){
+            code += ops[t % 4];
+            code += std::to_string(t + 1);
+        }
+        code += "\n";
+    }
+    return code;
+}
+
+// blocks nested depth deep, each level declaring a variable, repeated count times
+std::string generate_nesting(int count, int depth){
+    std::string code;
+    for(int i = 0; i < count; i++){
+        for(int d = 0; d < depth; d++){
+            code += "{\nlet n" + std::to_string(i) + "_" + std::to_string(d) + ": int = " + std::to_string(d) + "\n";
+        }
+        code += std::string(depth, '}') + "\n";
+    }
+    return code;
+}
+
+// many distinct string literals
+std::string generate_strings(int count){
+    std::string code;
+    for(int i = 0; i < count; i++){
+        code += "let s" + std::to_string(i) + ": string = \"string literal number " + std::to_string(i) + "\"\n";
+    }
+    return code;
+}
+
+// functions with wide parameter lists
+std::string generate_parameters(int count, int width){
+    std::string code;
+    for(int i = 0; i < count; i++){
+        code += "fn f" + std::to_string(i) + "(";
+        for(int p = 0; p < width; p++){
+            code += (p ? ", p" : "p") + std::to_string(p) + ": int";
+        }
+        code += "): int {\n    return p0\n}\n";
+    }
+    return code;
+}
+
+struct Scenario{
+    std::string name;
+    std::string code;
+};
+
+std::vector<Scenario> generate_scenarios(int scale){
+    return {
+        {"lets", generate_lets(20000 * scale)},
+        {"expressions", generate_expressions(200 * scale, 200)},
+        {"nesting", generate_nesting(200 * scale, 64)},
+        {"strings", generate_strings(20000 * scale)},
+        {"parameters", generate_parameters(200 * scale, 100)},
+    };
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// SECTION : PHASES
+// - every repetition runs in a fresh compiler context, only the phase itself is inside the timed region
+//-----------------------------------------------------------------------------------------------------------------------------
+
+const char* OUTPUT_NAME = "ion_bench_out";
+
+double elapsed_ms(std::chrono::steady_clock::time_point start){
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+double time_lexer(const std::string& code){
+    CompilerContext context;
+    auto start = std::chrono::steady_clock::now();
+    int index = 0;
+    while(get_token(code, index).token != Token::END_OF_FILE){}
+    return elapsed_ms(start);
+}
+
+double time_parser(const std::string& code){
+    CompilerContext context;
+    auto start = std::chrono::steady_clock::now();
+    std::unique_ptr<AST_program> program(parse_program(code));
+    return elapsed_ms(start);
+}
+
+double time_codegen(const std::string& code){
+    CompilerContext context;
+    std::unique_ptr<AST_program> program(parse_program(code));
+    resolve(program.get(), &context.globals);
+    auto start = std::chrono::steady_clock::now();
+    generate_code(program.get(), OUTPUT_NAME);
+    return elapsed_ms(start);
+}
+
+// the machine's own speed: strings built, sorted and hashed, which is the kind of work the compiler does, but
+// the same work whatever the compiler's code
+double time_reference(){
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::string> words;
+    uint32_t seed = 12345;
+    for(int i = 0; i < 100000; i++){
+        seed = seed * 1103515245 + 12345;
+        words.push_back("w" + std::to_string(seed % 50000));
+    }
+    std::sort(words.begin(), words.end());
+    std::unordered_map<std::string, int> counts;
+    for(const std::string& word : words){
+        counts[word]++;
+    }
+    if(counts.empty()) return -1;
+    return elapsed_ms(start);
+}
+
+// FUNCTION : best of
+// - fastest of reps runs, a negative time means the phase does not support the program
+double best_of(int reps, const std::function<double()>& run){
+    double best = -1;
+    for(int r = 0; r < reps; r++){
+        double ms;
+        try {
+            ms = run();
+        } catch (const std::runtime_error&) {
+            return -1;
+        }
+        best = best < 0 ? ms : std::min(best, ms);
+    }
+    return best;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// SECTION : BASELINE
+// - a "scale N" line, then one "scenario phase milliseconds" line per measurement, lines starting with # are comments
+// - the reference time taken with a scenario is its phase "reference"
+// - times only compare at the same scale, and as a ratio to the scenario's reference time when the baseline has one
+//-----------------------------------------------------------------------------------------------------------------------------
+
+using Results = std::map<std::string, double>;
+
+Results read_baseline(const std::string& path, int& scale){
+    Results baseline;
+    scale = 0;
+    std::ifstream file(path);
+    std::string line;
+    while(std::getline(file, line)){
+        if(line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        std::string scenario, phase;
+        double ms;
+        if(line.compare(0, 6, "scale ") == 0){
+            scale = std::atoi(line.c_str() + 6);
+        }else if(fields >> scenario >> phase >> ms){
+            baseline[scenario + " " + phase] = ms;
+        }
+    }
+    return baseline;
+}
+
+bool write_baseline(const std::string& path, const Results& results, int scale){
+    std::ofstream file(path);
+    if(!file) return false;
+    file << "# ion_bench baseline, fastest run in milliseconds, recorded on one machine\n";
+    file << "# phases compare as a ratio to their scenario's reference, regenerate with --update-baseline on the comparing machine\n";
+    file << "scale " << scale << "\n";
+    for(const auto& entry : results){
+        file << entry.first << " " << std::fixed << std::setprecision(3) << entry.second << "\n";
+    }
+    return (bool)file;
+}
+
+int main(int argc, char* argv[]){
+    int scale = 1;
+    int reps = 9;
+    double tolerance = 25;
+    bool update = false;
+    std::string baselinePath = "bench/baseline.txt";
+
+    for(int i = 1; i < argc; i++){
+        std::string arg(argv[i]);
+        if(arg == "--scale" && i + 1 < argc){
+            scale = std::max(1, std::atoi(argv[++i]));
+        }else if(arg == "--reps" && i + 1 < argc){
+            reps = std::max(1, std::atoi(argv[++i]));
+        }else if(arg == "--baseline" && i + 1 < argc){
+            baselinePath = argv[++i];
+        }else if(arg == "--tolerance" && i + 1 < argc){
+            tolerance = std::atof(argv[++i]);
+        }else if(arg == "--update-baseline"){
+            update = true;
+        }else{
+            std::cerr << "usage: ion_bench [--scale N] [--reps N] [--baseline FILE] [--tolerance PERCENT] [--update-baseline]\n";
+            return 2;
+        }
+    }
+
+    int baselineScale;
+    Results baseline = read_baseline(baselinePath, baselineScale);
+    if(!baseline.empty() && baselineScale != scale && !update){
+        std::cout << "Baseline was recorded at --scale " << baselineScale << ", not comparing\n";
+        baseline.clear();
+    }
+    Results results;
+    bool regressed = false;
+
+    std::cout << std::left << std::setw(14) << "scenario" << std::setw(10) << "phase" << std::right
+              << std::setw(10) << "bytes" << std::setw(12) << "ms" << std::setw(12) << "baseline" << std::setw(10) << "change\n";
+
+    for(const Scenario& scenario : generate_scenarios(scale)){
+        const std::string& code = scenario.code;
+        // the baseline column is the baseline time on this machine right now, the stored one scaled by the reference times
+        double reference = best_of(reps, time_reference);
+        results[scenario.name + " reference"] = reference;
+        auto stored = baseline.find(scenario.name + " reference");
+        double machine = stored != baseline.end() ? reference / stored->second : 1;
+        std::pair<const char*, std::function<double()>> phases[] = {
+            {"lex", [&]{ return time_lexer(code); }},
+            {"parse", [&]{ return time_parser(code); }},
+            {"codegen", [&]{ return time_codegen(code); }},
+        };
+
+        for(auto& phase : phases){
+            std::string key = scenario.name + " " + phase.first;
+            double ms = best_of(reps, phase.second);
+
+            std::cout << std::left << std::setw(14) << scenario.name << std::setw(10) << phase.first << std::right
+                      << std::setw(10) << code.size() << std::fixed << std::setprecision(3);
+            if(ms < 0){
+                std::cout << std::setw(12) << "unsupported" << "\n";
+                continue;
+            }
+            results[key] = ms;
+            std::cout << std::setw(12) << ms;
+
+            auto it = baseline.find(key);
+            if(it == baseline.end() || update){
+                std::cout << "\n";
+                continue;
+            }
+            double expected = it->second * machine;
+            double change = (ms / expected - 1) * 100;
+            std::cout << std::setw(12) << expected << std::setw(9) << std::setprecision(1) << std::showpos << change << "%" << std::noshowpos;
+            if(change > tolerance){
+                std::cout << "  REGRESSION";
+                regressed = true;
+            }
+            std::cout << "\n";
+        }
+    }
+    std::remove((std::string(OUTPUT_NAME) + ".asm").c_str());
+
+    if(update){
+        if(!write_baseline(baselinePath, results, scale)){
+            std::cerr << "ERR: Cannot write baseline: " << baselinePath << "\n";
+            return 1;
+        }
+        std::cout << "Baseline written to " << baselinePath << "\n";
+        return 0;
+    }
+    if(baseline.empty()){
+        std::cout << "No baseline at " << baselinePath << ", run with --update-baseline to create one\n";
+    }
+    return regressed ? 1 : 0;
+}
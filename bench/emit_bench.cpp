@@ -0,0 +1,62 @@
+// Emitter benchmark
+// - writes the same 10M instructions through the old std::ofstream path and through AsmEmitter
+// - build: g++ -std=c++17 -O2 -o emit_bench bench/emit_bench.cpp
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "../emitter.hpp"
+
+const long long INSTRUCTIONS = 10000000;
+const char* REGISTERS[] = {"r10", "r11", "r12", "r13"};
+
+// One instruction of the kinds codegen writes most: immediates, register pairs and stack slots
+template <typename Out>
+void emit(Out& out, long long i){
+    const char* reg = REGISTERS[i & 3];
+    switch(i % 3){
+        case 0: out << "    mov " << reg << ", " << i << "\n"; break;
+        case 1: out << "    add " << reg << ", " << REGISTERS[(i + 1) & 3] << "\n"; break;
+        case 2: out << "    mov dword [rbp - " << (int)(i & 0xFFF) << "], " << reg << "d\n"; break;
+    }
+}
+
+template <typename F>
+double time_ms(F f){
+    auto start = std::chrono::steady_clock::now();
+    f();
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+int main(int argc, char* argv[]){
+    std::string path = argc > 1 ? argv[1] : "emit_bench.asm";
+
+    double endlTime = time_ms([&]{
+        std::ofstream out(path);
+        for(long long i = 0; i < INSTRUCTIONS; i++){
+            emit(out, i);
+            out.flush(); // what std::endl does after the newline
+        }
+    });
+    double streamTime = time_ms([&]{
+        std::ofstream out(path);
+        for(long long i = 0; i < INSTRUCTIONS; i++) emit(out, i);
+    });
+    size_t bytes = 0;
+    double emitterTime = time_ms([&]{
+        AsmEmitter out;
+        for(long long i = 0; i < INSTRUCTIONS; i++) emit(out, i);
+        out.write_file(path);
+        bytes = out.size();
+    });
+    std::remove(path.c_str());
+
+    std::cout << INSTRUCTIONS << " instructions, " << bytes << " bytes\n";
+    std::cout << "ofstream + std::endl: " << endlTime << " ms\n";
+    std::cout << "ofstream + \\n:        " << streamTime << " ms\n";
+    std::cout << "AsmEmitter:          " << emitterTime << " ms\n";
+    return 0;
+}
@@ -0,0 +1,184 @@
+// Interpreter benchmark
+// - runs loop-heavy programs through the bytecode interpreter and through the native JIT, end to end from the source
+// - build: g++ -std=c++17 -O2 -pthread -o ion_interp_bench bench/interp_bench.cpp
+// - usage: ion_interp_bench [--scale N] [--reps N]
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../compiler.hpp"
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// SECTION : PROGRAM GENERATOR
+// - the programs write nothing, so the JIT-compiled ones do not flood the terminal
+//-----------------------------------------------------------------------------------------------------------------------------
+
+// arithmetic on a running sum, count iterations
+std::string generate_sum_loop(int count){
+    return "let i: int = 0\n"
+           "let s: int = 0\n"
+           "while (i < " + std::to_string(count) + ") {\n"
+           "    s = s + i * 3 % 7\n"
+           "    i = i + 1\n"
+           "}\n";
+}
+
+// two nested loops with a branch in the inner one, count iterations in total
+std::string generate_nested_loops(int count){
+    int side = 1;
+    while((long long)(side + 1) * (side + 1) <= count) side++;
+    return "let i: int = 0\n"
+           "let s: int = 0\n"
+           "while (i < " + std::to_string(side) + ") {\n"
+           "    let j: int = 0\n"
+           "    while (j < " + std::to_string(side) + ") {\n"
+           "        if (j % 2 == 0) {\n"
+           "            s = s + i\n"
+           "        } else {\n"
+           "            s = s - j\n"
+           "        }\n"
+           "        j = j + 1\n"
+           "    }\n"
+           "    i = i + 1\n"
+           "}\n";
+}
+
+// calls, recursive fibonacci
+std::string generate_fib(int n){
+    return "fn fib(n: int): int {\n"
+           "    if (n < 2) {\n"
+           "        return n\n"
+           "    }\n"
+           "    let a: int = n - 1\n"
+           "    let b: int = n - 2\n"
+           "    return fib(a) + fib(b)\n"
+           "}\n"
+           "let r: int = fib(" + std::to_string(n) + ")\n";
+}
+
+struct Program{
+    std::string name;
+    std::string code;
+    long long iterations;       // loop iterations, statements or calls the program runs
+};
+
+std::vector<Program> generate_programs(int scale){
+    int loops = 1000000 * scale;
+    return {
+        {"sum loop", generate_sum_loop(loops), loops},
+        {"nested loops", generate_nested_loops(loops), loops},
+        {"fib calls", generate_fib(24 + scale), 0},
+    };
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// SECTION : PATHS
+// - compile covers parsing up to runnable code, run is the program itself
+//-----------------------------------------------------------------------------------------------------------------------------
+
+struct Timing{
+    double compileMs = -1;      // negative when the path does not support the program
+    double runMs = -1;
+};
+
+double elapsed_ms(std::chrono::steady_clock::time_point start){
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+Timing time_interpreter(const std::string& code){
+    CompilerContext context;
+    Timing timing;
+    auto start = std::chrono::steady_clock::now();
+    std::unique_ptr<AST_program> program(parse_program(code));
+    resolve(program.get(), &context.globals);
+    BytecodeProgram bytecode = compile_bytecode(program.get());
+    timing.compileMs = elapsed_ms(start);
+
+    start = std::chrono::steady_clock::now();
+    Interpreter(bytecode).run();
+    timing.runMs = elapsed_ms(start);
+    return timing;
+}
+
+Timing time_native(const std::string& code){
+    CompilerContext context;
+    Timing timing;
+    auto start = std::chrono::steady_clock::now();
+    std::unique_ptr<AST_program> program(parse_program(code));
+    resolve(program.get(), &context.globals);
+    uint32_t entry = build_code(program.get(), Target::ELF64, Emit::JIT);
+    JitProgram jit(*asmCode, entry);
+    timing.compileMs = elapsed_ms(start);
+
+    start = std::chrono::steady_clock::now();
+    jit.run();
+    timing.runMs = elapsed_ms(start);
+    return timing;
+}
+
+// FUNCTION : best of
+// - fastest compile and fastest run of reps runs, both negative if the path does not support the program
+Timing best_of(int reps, const std::function<Timing()>& run){
+    Timing best;
+    for(int r = 0; r < reps; r++){
+        Timing t;
+        try {
+            t = run();
+        } catch (const std::runtime_error&) {
+            return Timing();
+        }
+        best.compileMs = best.compileMs < 0 ? t.compileMs : std::min(best.compileMs, t.compileMs);
+        best.runMs = best.runMs < 0 ? t.runMs : std::min(best.runMs, t.runMs);
+    }
+    return best;
+}
+
+int main(int argc, char* argv[]){
+    int scale = 1;
+    int reps = 5;
+    for(int i = 1; i < argc; i++){
+        std::string arg(argv[i]);
+        if(arg == "--scale" && i + 1 < argc){
+            scale = std::max(1, std::atoi(argv[++i]));
+        }else if(arg == "--reps" && i + 1 < argc){
+            reps = std::max(1, std::atoi(argv[++i]));
+        }else{
+            std::cerr << "usage: ion_interp_bench [--scale N] [--reps N]\n";
+            return 2;
+        }
+    }
+
+    std::cout << std::left << std::setw(22) << "program" << std::setw(8) << "path" << std::right
+              << std::setw(12) << "compile ms" << std::setw(12) << "run ms" << std::setw(12) << "total ms"
+              << std::setw(12) << "ns/iter" << "\n";
+
+    for(const Program& program : generate_programs(scale)){
+        std::pair<const char*, std::function<Timing()>> paths[] = {
+            {"interp", [&]{ return time_interpreter(program.code); }},
+            {"native", [&]{ return time_native(program.code); }},
+        };
+
+        for(auto& path : paths){
+            Timing t = best_of(reps, path.second);
+            std::cout << std::left << std::setw(22) << program.name << std::setw(8) << path.first << std::right
+                      << std::fixed << std::setprecision(3);
+            if(t.compileMs < 0){
+                std::cout << std::setw(12) << "unsupported" << "\n";
+                continue;
+            }
+            std::cout << std::setw(12) << t.compileMs << std::setw(12) << t.runMs << std::setw(12) << t.compileMs + t.runMs;
+            if(program.iterations > 0){
+                std::cout << std::setw(12) << std::setprecision(2) << t.runMs * 1e6 / program.iterations;
+            }
+            std::cout << "\n";
+        }
+    }
+    return 0;
+}
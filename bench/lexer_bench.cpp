@@ -0,0 +1,214 @@
+// Lexer benchmark
+// - times tokenize() over generated inputs that stress one part of get_token each
+// - keyword lookup is also timed on its own, the perfect hash against the chain of string compares it replaced
+// - and so is the scanning kernel, a walk from delimiter to delimiter with the scalar and the selected kernel
+// - build: g++ -std=c++17 -O2 -pthread -o ion_lexer_bench bench/lexer_bench.cpp
+// - usage: ion_lexer_bench [--scale N] [--reps N]
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../compiler.hpp"
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// SECTION : INPUT GENERATOR
+// - the inputs only have to lex, not to parse
+//-----------------------------------------------------------------------------------------------------------------------------
+
+// almost every word is a keyword
+std::string generate_keywords(int lines){
+    static const char* statements[] = {
+        "let a: int = 1\n",
+        "if (TRUE) {\n} else {\n}\n",
+        "while (FALSE) {\n}\n",
+        "fn f(b: bool, c: char, s: string): void {\n    return\n}\n",
+        "let x: float = 1.5\n",
+    };
+    std::string code;
+    for(int i = 0; i < lines; i++){
+        code += statements[i % 5];
+    }
+    return code;
+}
+
+// long identifiers, many sharing length and first or last letter with a keyword, so the lookup cannot reject them early
+std::string generate_identifiers(int lines){
+    static const char* words[] = {"items", "lettuce", "iff", "floating", "chart", "strings", "voids", "fnord", "whilst", "TRUTH"};
+    std::string code;
+    for(int i = 0; i < lines; i++){
+        code += words[i % 10];
+        code += "_" + std::to_string(i) + " = ";
+        for(int w = 1; w < 6; w++){
+            code += words[(i + w) % 10];
+            code += w < 5 ? " + " : "\n";
+        }
+    }
+    return code;
+}
+
+// long comment banners and indented statements, mostly skipped by scan_until and skip_blanks
+std::string generate_comments(int lines){
+    std::string code;
+    for(int i = 0; i < lines; i++){
+        switch(i % 4){
+            case 0: code += "#" + std::string(110, '-') + "\n"; break;
+            case 1: code += "# SECTION " + std::to_string(i) + " : the comment explains what the next statement does and why\n"; break;
+            case 2: code += "        let c" + std::to_string(i) + ": int = 1        # trailing comment after the statement\n"; break;
+            case 3: code += "#" + std::string(110, '-') + "\n\n"; break;
+        }
+    }
+    return code;
+}
+
+// long string literals and char literals, their bodies are found by scan_until
+std::string generate_literals(int lines){
+    std::string text;
+    for(int w = 0; w < 24; w++){
+        text += "literal text ";
+    }
+    std::string code;
+    for(int i = 0; i < lines; i++){
+        code += "let s" + std::to_string(i) + ": string = \"" + text + std::to_string(i) + "\"\n";
+        code += "let c" + std::to_string(i) + ": char = 'x'\n";
+    }
+    return code;
+}
+
+struct Input{
+    std::string name;
+    std::string code;
+};
+
+std::vector<Input> generate_inputs(int scale){
+    return {
+        {"keywords", generate_keywords(200000 * scale)},
+        {"identifiers", generate_identifiers(100000 * scale)},
+        {"comments", generate_comments(100000 * scale)},
+        {"literals", generate_literals(50000 * scale)},
+    };
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// SECTION : KEYWORD LOOKUP
+// - the chain of compares get_token ran on every identifier before the keyword table, kept here to compare against
+//-----------------------------------------------------------------------------------------------------------------------------
+
+Token lookup_keyword_chain(std::string_view word){
+    if(word == "int") return Token::INT;
+    else if(word == "float") return Token::FLOAT;
+    else if(word == "bool") return Token::BOOL;
+    else if(word == "char") return Token::CHAR;
+    else if(word == "string") return Token::STRING;
+    else if(word == "let") return Token::LET;
+    else if(word == "if") return Token::IF;
+    else if(word == "else") return Token::ELSE;
+    else if(word == "while") return Token::WHILE;
+    else if(word == "return") return Token::RETURN;
+    else if(word == "fn") return Token::FUNCTION;
+    else if(word == "void") return Token::VOID;
+    else if(word == "TRUE" || word == "FALSE") return Token::BOOL_literal;
+    return Token::IDENTIFIER;
+}
+
+// the words of an input, which are looked up as get_token would
+std::vector<std::string_view> words_of(const std::vector<TokenData>& tokens){
+    std::vector<std::string_view> words;
+    for(const TokenData& td : tokens){
+        if(!td.lexeme.empty() && isalpha(td.lexeme[0])){
+            words.push_back(td.lexeme);
+        }
+    }
+    return words;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// SECTION : MEASUREMENT
+//-----------------------------------------------------------------------------------------------------------------------------
+
+double elapsed_ms(std::chrono::steady_clock::time_point start){
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+double best_of(int reps, const std::function<double()>& run){
+    double best = -1;
+    for(int r = 0; r < reps; r++){
+        double ms = run();
+        best = best < 0 ? ms : std::min(best, ms);
+    }
+    return best;
+}
+
+// keeps the lookups from being optimized away
+volatile long long SINK = 0;
+
+double time_lookup(const std::vector<std::string_view>& words, Token (*lookup)(std::string_view)){
+    auto start = std::chrono::steady_clock::now();
+    long long keywords = 0;
+    for(std::string_view word : words){
+        keywords += lookup(word) != Token::IDENTIFIER;
+    }
+    SINK = keywords;
+    return elapsed_ms(start);
+}
+
+// steps through the input from one newline or quote to the next, like the lexer does through comments and literals
+double time_scan(const std::string& code, size_t (*scan)(const char*, size_t, char, char)){
+    auto start = std::chrono::steady_clock::now();
+    long long stops = 0;
+    for(size_t index = 0; index < code.size(); index++){
+        index += scan(code.data() + index, code.size() - index, '\n', '\"');
+        stops++;
+    }
+    SINK = stops;
+    return elapsed_ms(start);
+}
+
+int main(int argc, char* argv[]){
+    int scale = 1;
+    int reps = 9;
+    for(int i = 1; i < argc; i++){
+        std::string arg(argv[i]);
+        if(arg == "--scale" && i + 1 < argc){
+            scale = std::max(1, std::atoi(argv[++i]));
+        }else if(arg == "--reps" && i + 1 < argc){
+            reps = std::max(1, std::atoi(argv[++i]));
+        }else{
+            std::cerr << "usage: ion_lexer_bench [--scale N] [--reps N]\n";
+            return 2;
+        }
+    }
+
+    std::cout << std::left << std::setw(14) << "input" << std::right << std::setw(10) << "bytes" << std::setw(10) << "tokens"
+              << std::setw(14) << "tokenize ms" << std::setw(10) << "MB/s" << std::setw(10) << "words"
+              << std::setw(12) << "hash ms" << std::setw(12) << "chain ms" << std::setw(12) << "scalar ms" << std::setw(12) << "kernel ms" << "\n";
+
+    for(const Input& input : generate_inputs(scale)){
+        CompilerContext context;
+        size_t tokens = 0;
+        double tokenizeMs = best_of(reps, [&]{
+            auto start = std::chrono::steady_clock::now();
+            tokens = tokenize(input.code).size();
+            return elapsed_ms(start);
+        });
+
+        std::vector<std::string_view> words = words_of(tokenize(input.code));
+        double hashMs = best_of(reps, [&]{ return time_lookup(words, lookup_keyword); });
+        double chainMs = best_of(reps, [&]{ return time_lookup(words, lookup_keyword_chain); });
+        double scalarMs = best_of(reps, [&]{ return time_scan(input.code, scan_until_scalar); });
+        double kernelMs = best_of(reps, [&]{ return time_scan(input.code, scan_kernels().scan_until); });
+
+        std::cout << std::left << std::setw(14) << input.name << std::right << std::setw(10) << input.code.size()
+                  << std::setw(10) << tokens << std::fixed << std::setprecision(3) << std::setw(14) << tokenizeMs
+                  << std::setw(10) << std::setprecision(1) << input.code.size() / tokenizeMs / 1000
+                  << std::setw(10) << words.size() << std::setprecision(3) << std::setw(12) << hashMs << std::setw(12) << chainMs
+                  << std::setw(12) << scalarMs << std::setw(12) << kernelMs << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,175 @@
+// Register allocation benchmark
+// - wide and deep expression trees, which keep many values alive at once, through instruction selection,
+//   register allocation and the native JIT
+// - each program repeats one assignment rather than looping over it, so the allocator works through one interval per
+//   value of every copy, which a loop body would only hold once
+// - build: g++ -std=c++17 -O2 -pthread -o ion_regalloc_bench bench/regalloc_bench.cpp
+// - usage: ion_regalloc_bench [--scale N] [--reps N]
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../compiler.hpp"
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// SECTION : PROGRAM GENERATOR
+// - leaves cycle through variables and a remainder by a constant, so divisions take part in the allocation
+//-----------------------------------------------------------------------------------------------------------------------------
+
+std::string leaf(int i){
+    static const char* leaves[] = {"a", "b", "(c % 7)", "d", "(a % 5)", "c"};
+    return leaves[i % 6];
+}
+
+const char* op(int i){
+    static const char* ops[] = {" + ", " - ", " * ", " + "};
+    return ops[i % 4];
+}
+
+// a op (b op (c op ...)), every operand stays alive until the innermost one is done, terms values at once
+std::string chain(int terms){
+    std::string expression = leaf(terms - 1);
+    for(int i = terms - 2; i >= 0; i--){
+        expression = leaf(i) + op(i) + "(" + expression + ")";
+    }
+    return expression;
+}
+
+// a full binary tree, depth + 1 values at once
+std::string balanced(int depth, int& next){
+    if(depth == 0){
+        return leaf(next++);
+    }
+    std::string left = balanced(depth - 1, next);
+    std::string right = balanced(depth - 1, next);
+    return "(" + left + op(depth) + right + ")";
+}
+
+// a + b + c ..., two values at once however long it is
+std::string flat(int terms){
+    std::string expression = leaf(0);
+    for(int i = 1; i < terms; i++){
+        expression += op(i) + leaf(i);
+    }
+    return expression;
+}
+
+std::string generate_program(const std::string& expression, int statements){
+    std::string code = "let a: int = 17\nlet b: int = 5\nlet c: int = 9\nlet d: int = 3\nlet x: int = 0\n";
+    for(int i = 0; i < statements; i++){
+        code += "x = " + expression + "\n";
+    }
+    return code;
+}
+
+struct Program{
+    std::string name;
+    std::string code;
+    int statements;
+};
+
+std::vector<Program> generate_programs(int scale){
+    int statements = 200 * scale;
+    int next = 0;
+    std::vector<Program> programs;
+    programs.push_back({"flat 64", generate_program(flat(64), statements), statements});
+    programs.push_back({"chain 8", generate_program(chain(8), statements), statements});
+    programs.push_back({"chain 16", generate_program(chain(16), statements), statements});
+    programs.push_back({"chain 64", generate_program(chain(64), statements), statements});
+    programs.push_back({"balanced 4", generate_program(balanced(4, next), statements), statements});
+    programs.push_back({"balanced 6", generate_program(balanced(6, next), statements), statements});
+    programs.push_back({"balanced 16", generate_program(balanced(16, next), 1), 1});
+    return programs;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// SECTION : MEASUREMENT
+// - select is building the IR and instruction selection on virtual registers, regalloc the linear scan, run the JIT-compiled program
+//-----------------------------------------------------------------------------------------------------------------------------
+
+struct Timing{
+    double selectMs = 0;
+    double regallocMs = 0;
+    double runMs = 0;
+    AllocationStats stats;
+    size_t instructions = 0;
+};
+
+double elapsed_ms(std::chrono::steady_clock::time_point start){
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+Timing measure(const std::string& code){
+    CompilerContext context;
+    Timing timing;
+    std::unique_ptr<AST_program> program(parse_program(code));
+    resolve(program.get(), &context.globals);
+
+    auto start = std::chrono::steady_clock::now();
+    SelectedCode selected = select_instructions(build_ir(program.get()), Target::ELF64, Emit::JIT);
+    timing.selectMs = elapsed_ms(start);
+
+    start = std::chrono::steady_clock::now();
+    timing.stats = allocate_registers(*asmCode, selected.spills);
+    timing.regallocMs = elapsed_ms(start);
+    timing.instructions = asmCode->code.size();
+
+    JitProgram jit(*asmCode, selected.start);
+    start = std::chrono::steady_clock::now();
+    jit.run();
+    timing.runMs = elapsed_ms(start);
+    return timing;
+}
+
+int main(int argc, char* argv[]){
+    int scale = 1;
+    int reps = 5;
+    for(int i = 1; i < argc; i++){
+        std::string arg(argv[i]);
+        if(arg == "--scale" && i + 1 < argc){
+            scale = std::max(1, std::atoi(argv[++i]));
+        }else if(arg == "--reps" && i + 1 < argc){
+            reps = std::max(1, std::atoi(argv[++i]));
+        }else{
+            std::cerr << "usage: ion_regalloc_bench [--scale N] [--reps N]\n";
+            return 2;
+        }
+    }
+
+    std::cout << std::left << std::setw(14) << "program" << std::right << std::setw(10) << "vregs" << std::setw(10) << "spilled"
+              << std::setw(8) << "slots" << std::setw(10) << "instrs" << std::setw(12) << "select ms" << std::setw(12) << "regalloc ms"
+              << std::setw(10) << "run ms" << std::setw(12) << "ns/stmt" << "\n";
+
+    for(const Program& program : generate_programs(scale)){
+        Timing best;
+        for(int r = 0; r < reps; r++){
+            Timing t;
+            try {
+                t = measure(program.code);
+            } catch (const std::runtime_error& e) {
+                std::cerr << program.name << ": " << e.what() << "\n";
+                return 1;
+            }
+            if(r == 0){
+                best = t;
+                continue;
+            }
+            best.selectMs = std::min(best.selectMs, t.selectMs);
+            best.regallocMs = std::min(best.regallocMs, t.regallocMs);
+            best.runMs = std::min(best.runMs, t.runMs);
+        }
+
+        std::cout << std::left << std::setw(14) << program.name << std::right << std::setw(10) << best.stats.intervals
+                  << std::setw(10) << best.stats.spilled << std::setw(8) << best.stats.slots << std::setw(10) << best.instructions
+                  << std::fixed << std::setprecision(3) << std::setw(12) << best.selectMs << std::setw(12) << best.regallocMs
+                  << std::setw(10) << best.runMs << std::setw(12) << std::setprecision(1)
+                  << best.runMs * 1e6 / program.statements << "\n";
+    }
+    return 0;
+}
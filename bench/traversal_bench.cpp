@@ -0,0 +1,493 @@
+// AST traversal benchmark
+// - parses a program of 1M statements and walks the whole node table with a switch on the kind column
+// - then copies the tree into the layouts the table replaced and walks those:
+//      class tree  a class per kind with a virtual visit, nodes of the size the old classes had in an arena,
+//                  children in contiguous arrays
+//      std::list   heap nodes with std::list children, the layout before the arrays
+// - all walks visit the same nodes in the same order, the memory of the table and of the class tree is reported too
+// - build: g++ -std=c++17 -O2 -pthread -o ion_traversal_bench bench/traversal_bench.cpp
+// - usage: ion_traversal_bench [--statements N] [--reps N]
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../compiler.hpp"
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// SECTION : PROGRAM GENERATOR
+//-----------------------------------------------------------------------------------------------------------------------------
+
+// blocks, conditionals and loops of eight statements each, statements counts every statement including the nested ones
+std::string generate_program(int statements){
+    std::string code = "let x: int = 1\n";
+    for(int i = 1; i < statements; i += 10){
+        switch(i % 3){
+            case 0: code += "{\n"; break;
+            case 1: code += "if (x < " + std::to_string(i) + ") {\n"; break;
+            case 2: code += "while (x > " + std::to_string(i) + ") {\n"; break;
+        }
+        code += "    let y" + std::to_string(i) + ": int = x + " + std::to_string(i) + " * 2\n";
+        for(int s = 0; s < 7; s++){
+            code += "    y" + std::to_string(i) + " = y" + std::to_string(i) + " - x / " + std::to_string(s + 1) + "\n";
+        }
+        code += "}\nx = x + 1\n";
+    }
+    return code;
+}
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// SECTION : WALKS
+// - every node adds its kind to a checksum, so no walk can be optimized away
+//-----------------------------------------------------------------------------------------------------------------------------
+
+// Walks the node table
+struct TableWalk{
+    const AST_program& program;
+    long long sum = 0;
+
+    explicit TableWalk(const AST_program& program) : program(program) {}
+
+    void visit(node_id node){
+        sum += (int)program.type(node);
+        switch(program.type(node)){
+            case AST_type::UNARY:
+            case AST_type::RETURN:
+                visit(program.operand(node));
+                break;
+            case AST_type::BINARY:
+                visit(program.lhs(node));
+                visit(program.rhs(node));
+                break;
+            case AST_type::BLOCK:
+            case AST_type::FUNCTION_CALL:
+                for(node_id child : program.list(node)){
+                    visit(child);
+                }
+                break;
+            case AST_type::CONDITIONAL:
+                for(uint32_t i = 0; i < program.branches(node); i++){
+                    if(program.condition(node, i) != NO_NODE){
+                        visit(program.condition(node, i));
+                    }
+                    visit(program.body(node, i));
+                }
+                break;
+            case AST_type::LOOP:
+                visit(program.condition(node));
+                visit(program.body(node));
+                break;
+            case AST_type::FUNCTION:
+                for(node_id param : program.list(node)){
+                    visit(param);
+                }
+                visit(program.body(node));
+                break;
+            default:
+                break;
+        }
+    }
+};
+
+// CLASS : Class tree
+// - copy of the tree in the layout the node table replaced, with the members the old node classes had
+// - nodes are copied children first, the order the parser built the old tree in
+class ClassTree{
+public:
+    struct Node{
+        AST_type type;
+        bool effects = false;
+        uint16_t registers = 1;
+
+        explicit Node(AST_type type) : type(type) {}
+        virtual void visit(long long& sum) const = 0;
+    };
+
+    // the members of the arena-backed child arrays: arena, storage, count and capacity
+    struct Array{
+        Arena* arena = nullptr;
+        const Node** items = nullptr;
+        size_t count = 0;
+        size_t capacity = 0;
+
+        void visit(long long& sum) const {
+            for(size_t i = 0; i < count; i++){
+                if(items[i] != nullptr){
+                    items[i]->visit(sum);
+                }
+            }
+        }
+    };
+
+    struct Literal : Node{
+        uint32_t value;
+        Literal(AST_type type, uint32_t value) : Node(type), value(value) {}
+        void visit(long long& sum) const override { sum += (int)type; }
+    };
+
+    struct Variable : Node{
+        symbol_id name;
+        const metadata* data = nullptr;
+        int offset = 0;
+        bool declares = false;
+        explicit Variable(symbol_id name) : Node(AST_type::VARIABLE), name(name) {}
+        void visit(long long& sum) const override { sum += (int)type; }
+    };
+
+    struct Unary : Node{
+        std::string_view op;
+        const Node* expr;
+        Unary(std::string_view op, const Node* expr) : Node(AST_type::UNARY), op(op), expr(expr) {}
+        void visit(long long& sum) const override {
+            sum += (int)type;
+            expr->visit(sum);
+        }
+    };
+
+    struct Binary : Node{
+        std::string_view op;
+        const Node* lhs;
+        const Node* rhs;
+        Binary(std::string_view op, const Node* lhs, const Node* rhs) : Node(AST_type::BINARY), op(op), lhs(lhs), rhs(rhs) {}
+        void visit(long long& sum) const override {
+            sum += (int)type;
+            lhs->visit(sum);
+            rhs->visit(sum);
+        }
+    };
+
+    // blocks, conditionals (condition and body pairs) and calls, with the members of all three so it is as large as each
+    struct Listing : Node{
+        symbol_id name = 0;
+        Array children;
+        Table* scope = nullptr;
+        Listing(AST_type type, Array children) : Node(type), children(children) {}
+        void visit(long long& sum) const override {
+            sum += (int)type;
+            children.visit(sum);
+        }
+    };
+
+    struct Loop : Node{
+        const Node* condition;
+        const Node* body;
+        Loop(const Node* condition, const Node* body) : Node(AST_type::LOOP), condition(condition), body(body) {}
+        void visit(long long& sum) const override {
+            sum += (int)type;
+            condition->visit(sum);
+            body->visit(sum);
+        }
+    };
+
+    struct Function : Node{
+        symbol_id name;
+        Array parameters;
+        const Node* body;
+        Table* scope = nullptr;
+        Function(symbol_id name, Array parameters, const Node* body)
+            : Node(AST_type::FUNCTION), name(name), parameters(parameters), body(body) {}
+        void visit(long long& sum) const override {
+            sum += (int)type;
+            parameters.visit(sum);
+            body->visit(sum);
+        }
+    };
+
+    struct Return : Node{
+        const Node* expr;
+        explicit Return(const Node* expr) : Node(AST_type::RETURN), expr(expr) {}
+        void visit(long long& sum) const override {
+            sum += (int)type;
+            expr->visit(sum);
+        }
+    };
+
+    Arena arena;
+    std::vector<const Node*> roots;
+
+    explicit ClassTree(const AST_program& program) : program(program) {
+        for(node_id expr : program.expressions){
+            roots.push_back(copy(expr));
+        }
+    }
+
+private:
+    const AST_program& program;
+
+    Array array(const std::vector<const Node*>& nodes){
+        Array result;
+        result.arena = &arena;
+        result.items = static_cast<const Node**>(arena.allocate(nodes.size() * sizeof(Node*), alignof(Node*)));
+        std::copy(nodes.begin(), nodes.end(), result.items);
+        result.count = result.capacity = nodes.size();
+        return result;
+    }
+
+    Array copy_list(AST_list list){
+        std::vector<const Node*> nodes;
+        for(node_id child : list){
+            nodes.push_back(copy(child));
+        }
+        return array(nodes);
+    }
+
+    const Node* copy(node_id node){
+        if(node == NO_NODE){
+            return nullptr;
+        }
+        switch(program.type(node)){
+            case AST_type::VARIABLE:
+                return arena.make<Variable>(program.name(node));
+            case AST_type::UNARY: {
+                const Node* operand = copy(program.operand(node));
+                return arena.make<Unary>(arena.copy(ast_op_name(program.op(node))), operand);
+            }
+            case AST_type::BINARY: {
+                const Node* lhs = copy(program.lhs(node));
+                const Node* rhs = copy(program.rhs(node));
+                return arena.make<Binary>(arena.copy(ast_op_name(program.op(node))), lhs, rhs);
+            }
+            case AST_type::BLOCK:
+            case AST_type::FUNCTION_CALL:
+                return arena.make<Listing>(program.type(node), copy_list(program.list(node)));
+            case AST_type::CONDITIONAL: {
+                std::vector<const Node*> branches;
+                for(uint32_t i = 0; i < program.branches(node); i++){
+                    branches.push_back(copy(program.condition(node, i)));
+                    branches.push_back(copy(program.body(node, i)));
+                }
+                return arena.make<Listing>(AST_type::CONDITIONAL, array(branches));
+            }
+            case AST_type::LOOP: {
+                const Node* condition = copy(program.condition(node));
+                const Node* body = copy(program.body(node));
+                return arena.make<Loop>(condition, body);
+            }
+            case AST_type::FUNCTION: {
+                Array parameters = copy_list(program.list(node));
+                const Node* body = copy(program.body(node));
+                return arena.make<Function>(program.name(node), parameters, body);
+            }
+            case AST_type::RETURN:
+                return arena.make<Return>(copy(program.operand(node)));
+            default:
+                return arena.make<Literal>(program.type(node), program.a[node]);
+        }
+    }
+};
+
+// CLASS : List tree
+// - copy of the tree in the layout before the arrays: every node on its own heap allocation, at least as large as the
+//   class node it stands for, children in a std::list member
+class ListTree{
+public:
+    struct Node{
+        AST_type type;
+        Node* first = nullptr;      // operand of unary and return, LHS of binary, condition of loop
+        Node* second = nullptr;     // RHS of binary, body of loop
+        std::list<Node*> children;  // block children, condition and body pairs, parameters then body
+
+        Node(AST_type type) : type(type) {}
+    };
+
+    std::vector<Node*> roots;
+
+    explicit ListTree(const AST_program& program) : program(program) {
+        for(node_id expr : program.expressions){
+            roots.push_back(copy(expr));
+        }
+    }
+
+    ListTree(const ListTree&) = delete;
+    ListTree& operator=(const ListTree&) = delete;
+
+    ~ListTree(){
+        for(Node* node : nodes){
+            node->~Node();
+            ::operator delete(node);
+        }
+    }
+
+private:
+    const AST_program& program;
+    std::vector<Node*> nodes;
+
+    Node* make(node_id node, size_t size){
+        Node* made = new (::operator new(std::max(size, sizeof(Node)))) Node(program.type(node));
+        nodes.push_back(made);
+        return made;
+    }
+
+    Node* copy(node_id node){
+        if(node == NO_NODE){
+            return nullptr;
+        }
+        switch(program.type(node)){
+            case AST_type::UNARY:
+            case AST_type::RETURN: {
+                Node* operand = copy(program.operand(node));
+                Node* made = make(node, sizeof(ClassTree::Unary));
+                made->first = operand;
+                return made;
+            }
+            case AST_type::BINARY: {
+                Node* lhs = copy(program.lhs(node));
+                Node* rhs = copy(program.rhs(node));
+                Node* made = make(node, sizeof(ClassTree::Binary));
+                made->first = lhs;
+                made->second = rhs;
+                return made;
+            }
+            case AST_type::BLOCK:
+            case AST_type::FUNCTION_CALL: {
+                std::list<Node*> children;
+                for(node_id child : program.list(node)){
+                    children.push_back(copy(child));
+                }
+                Node* made = make(node, sizeof(ClassTree::Listing));
+                made->children = std::move(children);
+                return made;
+            }
+            case AST_type::CONDITIONAL: {
+                std::list<Node*> branches;
+                for(uint32_t i = 0; i < program.branches(node); i++){
+                    branches.push_back(copy(program.condition(node, i)));
+                    branches.push_back(copy(program.body(node, i)));
+                }
+                Node* made = make(node, sizeof(ClassTree::Listing));
+                made->children = std::move(branches);
+                return made;
+            }
+            case AST_type::LOOP: {
+                Node* condition = copy(program.condition(node));
+                Node* body = copy(program.body(node));
+                Node* made = make(node, sizeof(ClassTree::Loop));
+                made->first = condition;
+                made->second = body;
+                return made;
+            }
+            case AST_type::FUNCTION: {
+                std::list<Node*> children;
+                for(node_id param : program.list(node)){
+                    children.push_back(copy(param));
+                }
+                children.push_back(copy(program.body(node)));
+                Node* made = make(node, sizeof(ClassTree::Function));
+                made->children = std::move(children);
+                return made;
+            }
+            default:
+                return make(node, sizeof(ClassTree::Variable));
+        }
+    }
+};
+
+// Walks the list tree
+struct ListWalk{
+    long long sum = 0;
+
+    void visit(const ListTree::Node* node){
+        sum += (int)node->type;
+        if(node->first != nullptr){
+            visit(node->first);
+        }
+        if(node->second != nullptr){
+            visit(node->second);
+        }
+        for(const ListTree::Node* child : node->children){
+            if(child != nullptr){
+                visit(child);
+            }
+        }
+    }
+};
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// SECTION : MEASUREMENT
+//-----------------------------------------------------------------------------------------------------------------------------
+
+double elapsed_ms(std::chrono::steady_clock::time_point start){
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+double best_of(int reps, const std::function<double()>& run){
+    double best = -1;
+    for(int r = 0; r < reps; r++){
+        double ms = run();
+        best = best < 0 ? ms : std::min(best, ms);
+    }
+    return best;
+}
+
+int main(int argc, char* argv[]){
+    int statements = 1000000;
+    int reps = 9;
+    for(int i = 1; i < argc; i++){
+        std::string arg(argv[i]);
+        if(arg == "--statements" && i + 1 < argc){
+            statements = std::max(1, std::atoi(argv[++i]));
+        }else if(arg == "--reps" && i + 1 < argc){
+            reps = std::max(1, std::atoi(argv[++i]));
+        }else{
+            std::cerr << "usage: ion_traversal_bench [--statements N] [--reps N]\n";
+            return 2;
+        }
+    }
+
+    CompilerContext context;
+    std::string code = generate_program(statements);
+    auto start = std::chrono::steady_clock::now();
+    std::unique_ptr<AST_program> program(parse_program(code));
+    double parseMs = elapsed_ms(start);
+
+    TableWalk table(*program);
+    double tableMs = best_of(reps, [&]{
+        table.sum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for(node_id expr : program->expressions){
+            table.visit(expr);
+        }
+        return elapsed_ms(start);
+    });
+
+    ClassTree classes(*program);
+    long long classSum = 0;
+    double classMs = best_of(reps, [&]{
+        classSum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for(const ClassTree::Node* root : classes.roots){
+            root->visit(classSum);
+        }
+        return elapsed_ms(start);
+    });
+
+    ListTree tree(*program);
+    ListWalk lists;
+    double listMs = best_of(reps, [&]{
+        lists.sum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for(const ListTree::Node* root : tree.roots){
+            lists.visit(root);
+        }
+        return elapsed_ms(start);
+    });
+
+    if(table.sum != classSum || table.sum != lists.sum){
+        std::cerr << "ERR: the walks disagree\n";
+        return 1;
+    }
+    std::cout << statements << " statements, " << program->size() << " nodes, " << code.size() << " bytes, parsed in "
+              << std::fixed << std::setprecision(3) << parseMs << " ms\n";
+    std::cout << "node table walk: " << tableMs << " ms, " << program->bytes_used() / 1024 << " KB\n";
+    std::cout << "class tree walk: " << classMs << " ms, " << classes.arena.bytes_used() / 1024 << " KB\n";
+    std::cout << "std::list walk:  " << listMs << " ms\n";
+    return 0;
+}
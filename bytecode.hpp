@@ -0,0 +1,725 @@
+#ifndef BYTECODE_HPP
+#define BYTECODE_HPP
+
+#include <cstdint>
+#include <deque>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ast.hpp"
+#include "table.hpp"
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// SECTION : BYTECODE
+// - register-based, every instruction is 8 bytes: an opcode and three 16-bit operands
+// - registers are 64-bit slots relative to the frame of the running function
+// - a 32-bit operand is stored in b and c, jumps are relative to the instruction after them
+//-----------------------------------------------------------------------------------------------------------------------------
+
+// OPCODES
+// - R[x] is register x of the current frame, K is the 32-bit operand in b and c
+// - the compare-and-jump opcodes are followed by a JMP, which is taken if the comparison holds and skipped otherwise
+#define ION_OPCODES(X) \
+    X(LOADI)        /* R[a] = K                                         */ \
+    X(LOADK)        /* R[a] = constants[K]                              */ \
+    X(MOVE)         /* R[a] = R[b]                                      */ \
+    X(GETG)         /* R[a] = global register K                         */ \
+    X(SETG)         /* global register K = R[a]                         */ \
+    X(ADD)          /* R[a] = R[b] + R[c]                               */ \
+    X(ADDI)         /* R[a] = R[b] + c, c is signed                     */ \
+    X(SUB)          /* R[a] = R[b] - R[c]                               */ \
+    X(MUL)          /* R[a] = R[b] * R[c]                               */ \
+    X(DIV)          /* R[a] = R[b] / R[c]                               */ \
+    X(MOD)          /* R[a] = R[b] % R[c]                               */ \
+    X(NEG)          /* R[a] = -R[b]                                     */ \
+    X(NOT)          /* R[a] = !R[b]                                     */ \
+    X(EQ)           /* R[a] = R[b] == R[c]                              */ \
+    X(NE)           /* R[a] = R[b] != R[c]                              */ \
+    X(LT)           /* R[a] = R[b] < R[c]                               */ \
+    X(LE)           /* R[a] = R[b] <= R[c]                              */ \
+    X(GT)           /* R[a] = R[b] > R[c]                               */ \
+    X(GE)           /* R[a] = R[b] >= R[c]                              */ \
+    X(JMP)          /* jump by K                                        */ \
+    X(JMPF)         /* jump by K if R[a] is 0                           */ \
+    X(JMPT)         /* jump by K if R[a] is not 0                       */ \
+    X(JEQ)          /* take the next JMP if R[a] == R[b]                */ \
+    X(JNE)          /* take the next JMP if R[a] != R[b]                */ \
+    X(JLT)          /* take the next JMP if R[a] < R[b]                 */ \
+    X(JLE)          /* take the next JMP if R[a] <= R[b]                */ \
+    X(JGT)          /* take the next JMP if R[a] > R[b]                 */ \
+    X(JGE)          /* take the next JMP if R[a] >= R[b]                */ \
+    X(CALL)         /* R[a] = functions[b](R[c], R[c + 1], ...)         */ \
+    X(RET)          /* return R[a] to the caller, ends the program in main */ \
+    X(WRITE_INT)    /* write R[a] as a decimal number                   */ \
+    X(WRITE_CHAR)   /* write R[a] as a character                        */ \
+    X(WRITE_BOOL)   /* write R[a] as TRUE or FALSE                      */ \
+    X(WRITE_STR)    /* write the null-terminated string at R[a]         */
+
+enum class Opcode : uint8_t {
+#define ION_OPCODE_ENUM(name) name,
+    ION_OPCODES(ION_OPCODE_ENUM)
+#undef ION_OPCODE_ENUM
+};
+
+const char* opcode_name(Opcode op){
+    static const char* const names[] = {
+#define ION_OPCODE_NAME(name) #name,
+        ION_OPCODES(ION_OPCODE_NAME)
+#undef ION_OPCODE_NAME
+    };
+    return names[(int)op];
+}
+
+// INSTRUCTION
+struct Instruction{
+    Opcode op;
+    uint16_t a = 0;
+    uint16_t b = 0;
+    uint16_t c = 0;
+
+    int32_t k() const {
+        return (int32_t)((uint32_t)b | (uint32_t)c << 16);
+    }
+
+    void set_k(int32_t value){
+        b = (uint16_t)((uint32_t)value & 0xFFFF);
+        c = (uint16_t)((uint32_t)value >> 16);
+    }
+};
+
+// FUNCTION
+// - parameters arrive in the first registers of the frame
+struct BytecodeFunction{
+    std::string name;
+    uint32_t entry = 0;
+    uint16_t parameters = 0;
+    uint16_t registers = 0;     // frame size
+};
+
+// CLASS : Bytecode program
+// - function 0 is the top level of the program
+class BytecodeProgram{
+public:
+    std::vector<Instruction> code;
+    std::vector<int64_t> constants;
+    std::deque<std::string> strings;        // string literals, LOADK constants point into them
+    std::vector<BytecodeFunction> functions;
+
+    // Method to print the instructions, one per line
+    void print(std::ostream& os) const {
+        for(size_t f = 0; f < functions.size(); f++){
+            const BytecodeFunction& function = functions[f];
+            uint32_t end = f + 1 < functions.size() ? functions[f + 1].entry : (uint32_t)code.size();
+            os << function.name << ": parameters " << function.parameters << ", registers " << function.registers << "\n";
+            for(uint32_t i = function.entry; i < end; i++){
+                print_instruction(os, i);
+            }
+        }
+    }
+
+private:
+    void print_instruction(std::ostream& os, uint32_t index) const {
+        const Instruction& in = code[index];
+        os << "  " << index << "\t" << opcode_name(in.op) << "\t";
+        switch(in.op){
+            case Opcode::LOADI:
+                os << "r" << in.a << ", " << in.k();
+                break;
+            case Opcode::LOADK:
+                os << "r" << in.a << ", k" << in.k();
+                break;
+            case Opcode::GETG:
+            case Opcode::SETG:
+                os << "r" << in.a << ", g" << in.k();
+                break;
+            case Opcode::ADDI:
+                os << "r" << in.a << ", r" << in.b << ", " << (int16_t)in.c;
+                break;
+            case Opcode::MOVE:
+            case Opcode::NEG:
+            case Opcode::NOT:
+            case Opcode::JEQ:
+            case Opcode::JNE:
+            case Opcode::JLT:
+            case Opcode::JLE:
+            case Opcode::JGT:
+            case Opcode::JGE:
+                os << "r" << in.a << ", r" << in.b;
+                break;
+            case Opcode::JMP:
+                os << "-> " << (int64_t)index + 1 + in.k();
+                break;
+            case Opcode::JMPF:
+            case Opcode::JMPT:
+                os << "r" << in.a << " -> " << (int64_t)index + 1 + in.k();
+                break;
+            case Opcode::CALL:
+                os << "r" << in.a << ", " << functions[in.b].name << ", r" << in.c;
+                break;
+            case Opcode::RET:
+            case Opcode::WRITE_INT:
+            case Opcode::WRITE_CHAR:
+            case Opcode::WRITE_BOOL:
+            case Opcode::WRITE_STR:
+                os << "r" << in.a;
+                break;
+            default:
+                os << "r" << in.a << ", r" << in.b << ", r" << in.c;
+                break;
+        }
+        os << "\n";
+    }
+};
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// SECTION : BYTECODE COMPILER
+// - one pass over the resolved AST, the top level first and then the functions
+// - an expression is compiled into a destination register, or into whichever register is cheapest when none is given:
+//   a variable is used in place, anything else goes into the next free temporary
+// - temporaries are freed after every statement, a block's variables when the block ends
+//-----------------------------------------------------------------------------------------------------------------------------
+
+// CLASS : Bytecode compiler
+class BytecodeCompiler{
+public:
+    BytecodeProgram compile(const AST_program* program){
+        this->program = program;
+        out = BytecodeProgram();
+        writeName = SYMBOLS->intern("write");
+        readName = SYMBOLS->intern("read");
+
+        // functions are numbered first, so calls can come before definitions
+        out.functions.push_back(BytecodeFunction{"main"});
+        for(node_id expr : program->expressions){
+            if(program->type(expr) == AST_type::FUNCTION){
+                functionIndex[program->name(expr)] = (uint32_t)out.functions.size();
+                BytecodeFunction compiled{std::string(SYMBOLS->name(program->name(expr)))};
+                compiled.parameters = (uint16_t)program->list(expr).size();
+                out.functions.push_back(compiled);
+            }
+        }
+
+        begin_function(0);
+        for(node_id expr : program->expressions){
+            if(program->type(expr) != AST_type::FUNCTION){
+                statement(expr);
+            }
+        }
+        end_function(0);
+        globals = locals;
+
+        for(node_id expr : program->expressions){
+            if(program->type(expr) == AST_type::FUNCTION){
+                compile_function(expr);
+            }
+        }
+        return std::move(out);
+    }
+
+private:
+    // a value of a known type in a register
+    struct Value{
+        uint16_t reg;
+        data_type type;
+    };
+
+    // a jump target, jumps to it are patched when it is placed
+    struct Label{
+        int64_t position = -1;
+        std::vector<uint32_t> jumps;
+    };
+
+    const AST_program* program = nullptr;
+    BytecodeProgram out;
+    symbol_id writeName = 0;
+    symbol_id readName = 0;
+    std::unordered_map<symbol_id, uint32_t> functionIndex;
+    std::unordered_map<const metadata*, uint16_t> locals;       // variables of the function being compiled
+    std::unordered_map<const metadata*, uint16_t> globals;      // top-level variables, in the frame of main
+    std::vector<const metadata*> declared;                      // locals in declaration order, for leaving blocks
+    uint32_t top = 0;           // next free register
+    uint32_t localsTop = 0;     // registers below this hold variables
+    uint32_t maxTop = 0;
+    uint32_t function = 0;
+
+    //-------------------------------------------------------------------------------------------------------------------------
+    // Emitting
+
+    uint32_t emit(Opcode op, uint32_t a = 0, uint32_t b = 0, uint32_t c = 0){
+        out.code.push_back(Instruction{op, (uint16_t)a, (uint16_t)b, (uint16_t)c});
+        return (uint32_t)out.code.size() - 1;
+    }
+
+    uint32_t emit_k(Opcode op, uint32_t a, int32_t k){
+        Instruction in{op, (uint16_t)a};
+        in.set_k(k);
+        out.code.push_back(in);
+        return (uint32_t)out.code.size() - 1;
+    }
+
+    void jump(Opcode op, uint32_t a, Label& target){
+        uint32_t at = emit_k(op, a, 0);
+        if(target.position >= 0){
+            out.code[at].set_k((int32_t)(target.position - (at + 1)));
+        }else{
+            target.jumps.push_back(at);
+        }
+    }
+
+    void place(Label& label){
+        label.position = (int64_t)out.code.size();
+        for(uint32_t at : label.jumps){
+            out.code[at].set_k((int32_t)(label.position - (at + 1)));
+        }
+        label.jumps.clear();
+    }
+
+    uint16_t allocate(){
+        if(top >= 0xFFFF){
+            throw std::runtime_error("Too many registers in one function");
+        }
+        if(++top > maxTop){
+            maxTop = top;
+        }
+        return (uint16_t)(top - 1);
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------------
+    // Functions, blocks and statements
+
+    void begin_function(uint32_t index){
+        function = index;
+        out.functions[index].entry = (uint32_t)out.code.size();
+        locals.clear();
+        declared.clear();
+        top = localsTop = maxTop = 0;
+    }
+
+    // a function without a return gives 0, the top level ends the program
+    void end_function(uint32_t index){
+        uint16_t zero = allocate();
+        emit_k(Opcode::LOADI, zero, 0);
+        emit(Opcode::RET, zero);
+        out.functions[index].registers = (uint16_t)maxTop;
+    }
+
+    void compile_function(node_id node){
+        uint32_t index = functionIndex[program->name(node)];
+        begin_function(index);
+        for(node_id param : program->list(node)){
+            if(program->type(param) != AST_type::VARIABLE){
+                throw std::runtime_error("Function parameters must be names");
+            }
+            declare(program->variable(param));
+        }
+        block(program->body(node));
+        end_function(index);
+    }
+
+    uint16_t declare(const metadata* data){
+        uint16_t reg = allocate();
+        locals[data] = reg;
+        declared.push_back(data);
+        localsTop = top;
+        return reg;
+    }
+
+    void statement(node_id expr){
+        switch(program->type(expr)){
+            case AST_type::BLOCK:
+                block(expr);
+                break;
+            case AST_type::CONDITIONAL:
+                conditional(expr);
+                break;
+            case AST_type::LOOP:
+                loop(expr);
+                break;
+            case AST_type::RETURN:
+                emit(Opcode::RET, compile(program->operand(expr)).reg);
+                break;
+            case AST_type::FUNCTION:
+                throw std::runtime_error("Functions can only be defined at the top level");
+            default:
+                compile(expr);
+                break;
+        }
+        top = localsTop;
+    }
+
+    void block(node_id node){
+        size_t declaredBefore = declared.size();
+        uint32_t localsBefore = localsTop;
+        for(node_id child : program->list(node)){
+            statement(child);
+        }
+
+        // the block's variables go out of scope, their registers are reused
+        while(declared.size() > declaredBefore){
+            locals.erase(declared.back());
+            declared.pop_back();
+        }
+        top = localsTop = localsBefore;
+    }
+
+    void conditional(node_id node){
+        Label end;
+        uint32_t branches = program->branches(node);
+        for(uint32_t i = 0; i < branches; i++){
+            Label next;
+            if(program->condition(node, i) != NO_NODE){
+                branch_if(program->condition(node, i), false, next);
+                top = localsTop;
+            }
+            block(program->body(node, i));
+            if(i + 1 < branches){
+                jump(Opcode::JMP, 0, end);
+            }
+            place(next);
+        }
+        place(end);
+    }
+
+    // the condition is tested at the bottom, so an iteration runs one jump
+    void loop(node_id node){
+        Label body, condition;
+        jump(Opcode::JMP, 0, condition);
+        place(body);
+        block(program->body(node));
+        place(condition);
+        branch_if(program->condition(node), true, body);
+        top = localsTop;
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------------
+    // Conditions
+
+    // compare-and-jump opcode for op, or for its negation
+    static Opcode compare_jump(AST_op op, bool negate){
+        switch(op){
+            case AST_op::EQUAL: return negate ? Opcode::JNE : Opcode::JEQ;
+            case AST_op::NOT_EQUAL: return negate ? Opcode::JEQ : Opcode::JNE;
+            case AST_op::LESS: return negate ? Opcode::JGE : Opcode::JLT;
+            case AST_op::LESS_EQUAL: return negate ? Opcode::JGT : Opcode::JLE;
+            case AST_op::GREATER: return negate ? Opcode::JLE : Opcode::JGT;
+            default: return negate ? Opcode::JLT : Opcode::JGE;
+        }
+    }
+
+    // Method to jump to target when the condition is equal to when
+    void branch_if(node_id condition, bool when, Label& target){
+        if(program->type(condition) == AST_type::BINARY){
+            AST_op op = program->op(condition);
+            if(is_comparison(op)){
+                uint32_t mark = top;
+                Value lhs = compile(program->lhs(condition));
+                Value rhs = compile(program->rhs(condition));
+                check_comparable(op, lhs, rhs);
+                top = mark;
+                emit(compare_jump(op, !when), lhs.reg, rhs.reg);
+                jump(Opcode::JMP, 0, target);
+                return;
+            }
+
+            // short circuit, "a && b" is false as soon as a is and "a || b" is true as soon as a is
+            bool isAnd = op == AST_op::AND;
+            if(isAnd || op == AST_op::OR){
+                if(isAnd != when){
+                    branch_if(program->lhs(condition), when, target);
+                    branch_if(program->rhs(condition), when, target);
+                }else{
+                    Label skip;
+                    branch_if(program->lhs(condition), !when, skip);
+                    branch_if(program->rhs(condition), when, target);
+                    place(skip);
+                }
+                return;
+            }
+        }
+
+        uint32_t mark = top;
+        Value value = compile(condition);
+        top = mark;
+        jump(when ? Opcode::JMPT : Opcode::JMPF, value.reg, target);
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------------
+    // Expressions
+
+    static bool is_integer(const Value& v){
+        return v.type == data_type::INTEGER;
+    }
+
+    static void check_comparable(AST_op op, const Value& lhs, const Value& rhs){
+        bool ordered = op != AST_op::EQUAL && op != AST_op::NOT_EQUAL;
+        if(lhs.type != rhs.type || lhs.type == data_type::UNKNOWN || lhs.type == data_type::FLOAT
+            || (ordered && lhs.type != data_type::INTEGER && lhs.type != data_type::CHAR)){
+            throw std::runtime_error("Unsupported operation " + std::string(ast_op_name(op)) + " on these types");
+        }
+    }
+
+    // the register to put a result in, a new temporary when there is no destination
+    uint16_t target_register(int dst){
+        return dst >= 0 ? (uint16_t)dst : allocate();
+    }
+
+    Value compile(node_id expr, int dst = -1){
+        switch(program->type(expr)){
+            case AST_type::INTEGER: {
+                uint16_t reg = target_register(dst);
+                emit_k(Opcode::LOADI, reg, program->integer(expr));
+                return Value{reg, data_type::INTEGER};
+            }
+            case AST_type::BOOLEAN: {
+                uint16_t reg = target_register(dst);
+                emit_k(Opcode::LOADI, reg, program->boolean(expr) ? 1 : 0);
+                return Value{reg, data_type::BOOLEAN};
+            }
+            case AST_type::CHAR: {
+                uint16_t reg = target_register(dst);
+                emit_k(Opcode::LOADI, reg, (unsigned char)program->character(expr));
+                return Value{reg, data_type::CHAR};
+            }
+            case AST_type::STRING: {
+                uint16_t reg = target_register(dst);
+                emit_k(Opcode::LOADK, reg, string_constant(program->string(expr)));
+                return Value{reg, data_type::STRING};
+            }
+            case AST_type::FLOAT:
+                throw std::runtime_error("Float not implemented yet");
+            case AST_type::VARIABLE:
+                return variable(expr, dst);
+            case AST_type::UNARY:
+                return unary(expr, dst);
+            case AST_type::BINARY:
+                return binary(expr, dst);
+            case AST_type::FUNCTION_CALL:
+                return call(expr, dst);
+            default:
+                throw std::runtime_error("Statement used as a value");
+        }
+    }
+
+    int32_t string_constant(symbol_id literal){
+        out.strings.emplace_back(SYMBOLS->name(literal));
+        out.constants.push_back((int64_t)(intptr_t)out.strings.back().c_str());
+        return (int32_t)out.constants.size() - 1;
+    }
+
+    Value variable(node_id node, int dst){
+        const metadata* data = program->variable(node);
+        auto it = locals.find(data);
+        if(it != locals.end()){
+            if(dst >= 0 && dst != it->second){
+                emit(Opcode::MOVE, dst, it->second);
+                return Value{(uint16_t)dst, data->type};
+            }
+            return Value{it->second, data->type};
+        }
+
+        // a top-level variable used inside a function lives in the frame of main
+        if(function != 0){
+            auto global = globals.find(data);
+            if(global != globals.end()){
+                uint16_t reg = target_register(dst);
+                emit_k(Opcode::GETG, reg, global->second);
+                return Value{reg, data->type};
+            }
+        }
+
+        uint16_t reg = declare(data);
+        if(dst >= 0){
+            emit(Opcode::MOVE, dst, reg);
+            return Value{(uint16_t)dst, data->type};
+        }
+        return Value{reg, data->type};
+    }
+
+    Value unary(node_id node, int dst){
+        AST_op op = program->op(node);
+        uint32_t mark = top;
+        Value operand = compile(program->operand(node));
+        top = mark;
+        if(op == AST_op::PLUS){
+            if(!is_integer(operand)) throw std::runtime_error("Unsupported operation + on non-integer types");
+            if(dst >= 0 && dst != operand.reg){
+                emit(Opcode::MOVE, dst, operand.reg);
+                operand.reg = (uint16_t)dst;
+            }
+            return operand;
+        }
+
+        uint16_t reg = target_register(dst);
+        if(op == AST_op::MINUS){
+            if(!is_integer(operand)) throw std::runtime_error("Unsupported operation - on non-integer types");
+            emit(Opcode::NEG, reg, operand.reg);
+            return Value{reg, data_type::INTEGER};
+        }
+        if(operand.type != data_type::BOOLEAN) throw std::runtime_error("Unsupported operation ! on non-boolean types");
+        emit(Opcode::NOT, reg, operand.reg);
+        return Value{reg, data_type::BOOLEAN};
+    }
+
+    Value assignment(node_id node){
+        node_id variable = program->lhs(node);
+        if(program->type(variable) != AST_type::VARIABLE){
+            throw std::runtime_error("Left-hand side of assignment must be a variable");
+        }
+        metadata* data = program->variable(variable);
+
+        // a top-level variable assigned inside a function is computed locally, then stored
+        bool global = function != 0 && locals.find(data) == locals.end() && globals.find(data) != globals.end();
+        uint16_t reg = global ? allocate() : this->variable(variable, -1).reg;
+
+        uint32_t mark = top;
+        Value value = compile(program->rhs(node), reg);
+        top = mark;
+        if(data->type == data_type::UNKNOWN){
+            data->type = value.type;
+        }else if(data->type != value.type){
+            throw std::runtime_error("Unsupported operation = on non-matching types");
+        }
+
+        if(global){
+            emit_k(Opcode::SETG, reg, globals[data]);
+        }
+        return Value{reg, data->type};
+    }
+
+    Value binary(node_id node, int dst){
+        AST_op op = program->op(node);
+        node_id left = program->lhs(node), right = program->rhs(node);
+        if(op == AST_op::ASSIGN){
+            Value value = assignment(node);
+            if(dst >= 0 && dst != value.reg){
+                emit(Opcode::MOVE, dst, value.reg);
+                value.reg = (uint16_t)dst;
+            }
+            return value;
+        }
+
+        // the result is built in a temporary, the right side may still read the destination
+        if(op == AST_op::AND || op == AST_op::OR){
+            uint32_t mark = top;
+            uint16_t result = allocate();
+            Label end;
+            Value lhs = compile(left, result);
+            jump(op == AST_op::AND ? Opcode::JMPF : Opcode::JMPT, result, end);
+            Value rhs = compile(right, result);
+            place(end);
+            if(lhs.type != data_type::BOOLEAN || rhs.type != data_type::BOOLEAN){
+                throw std::runtime_error("Unsupported operation " + std::string(ast_op_name(op)) + " on non-boolean types");
+            }
+            top = mark;
+            uint16_t reg = target_register(dst);
+            if(reg != result){
+                emit(Opcode::MOVE, reg, result);
+            }
+            return Value{reg, data_type::BOOLEAN};
+        }
+
+        // small constants are added in place
+        if((op == AST_op::PLUS || op == AST_op::MINUS) && program->type(right) == AST_type::INTEGER){
+            int64_t constant = program->integer(right);
+            if(op == AST_op::MINUS) constant = -constant;
+            if(constant >= INT16_MIN && constant <= INT16_MAX){
+                uint32_t mark = top;
+                Value lhs = compile(left);
+                top = mark;
+                if(!is_integer(lhs)){
+                    throw std::runtime_error("Unsupported operation " + std::string(ast_op_name(op)) + " on non-integer types");
+                }
+                uint16_t reg = target_register(dst);
+                emit(Opcode::ADDI, reg, lhs.reg, (uint16_t)(int16_t)constant);
+                return Value{reg, data_type::INTEGER};
+            }
+        }
+
+        uint32_t mark = top;
+        Value lhs = compile(left);
+        Value rhs = compile(right);
+        top = mark;
+        uint16_t reg = target_register(dst);
+
+        if(is_comparison(op)){
+            check_comparable(op, lhs, rhs);
+            Opcode code = op == AST_op::EQUAL ? Opcode::EQ : op == AST_op::NOT_EQUAL ? Opcode::NE : op == AST_op::LESS ? Opcode::LT
+                        : op == AST_op::LESS_EQUAL ? Opcode::LE : op == AST_op::GREATER ? Opcode::GT : Opcode::GE;
+            emit(code, reg, lhs.reg, rhs.reg);
+            return Value{reg, data_type::BOOLEAN};
+        }
+
+        Opcode code;
+        switch(op){
+            case AST_op::PLUS: code = Opcode::ADD; break;
+            case AST_op::MINUS: code = Opcode::SUB; break;
+            case AST_op::TIMES: code = Opcode::MUL; break;
+            case AST_op::DIVIDE: code = Opcode::DIV; break;
+            case AST_op::MODULO: code = Opcode::MOD; break;
+            default: throw std::runtime_error("Unsupported operator " + std::string(ast_op_name(op)));
+        }
+        if(!is_integer(lhs) || !is_integer(rhs)){
+            throw std::runtime_error("Unsupported operation " + std::string(ast_op_name(op)) + " on non-integer types");
+        }
+        emit(code, reg, lhs.reg, rhs.reg);
+        return Value{reg, data_type::INTEGER};
+    }
+
+    Value call(node_id node, int dst){
+        symbol_id name = program->name(node);
+        AST_list parameters = program->list(node);
+        if(name == writeName){
+            for(node_id param : parameters){
+                uint32_t mark = top;
+                Value arg = compile(param);
+                top = mark;
+                if(arg.type == data_type::INTEGER) emit(Opcode::WRITE_INT, arg.reg);
+                else if(arg.type == data_type::CHAR) emit(Opcode::WRITE_CHAR, arg.reg);
+                else if(arg.type == data_type::BOOLEAN) emit(Opcode::WRITE_BOOL, arg.reg);
+                else if(arg.type == data_type::STRING) emit(Opcode::WRITE_STR, arg.reg);
+                else throw std::runtime_error("Unsupported argument type in write");
+            }
+            return Value{0, data_type::UNKNOWN};
+        }
+        if(name == readName){
+            throw std::runtime_error("Function call not implemented yet");
+        }
+
+        auto it = functionIndex.find(name);
+        if(it == functionIndex.end()){
+            throw std::runtime_error("Function not found: " + std::string(SYMBOLS->name(name)));
+        }
+        if(parameters.size() != out.functions[it->second].parameters){
+            throw std::runtime_error("Wrong number of arguments to " + std::string(SYMBOLS->name(name)));
+        }
+
+        // arguments go into consecutive registers, which become the callee's parameters
+        uint32_t mark = top;
+        uint32_t first = top;
+        for(uint32_t i = 0; i < parameters.size(); i++){
+            allocate();
+        }
+        for(uint32_t i = 0; i < parameters.size(); i++){
+            compile(parameters[i], first + i);
+        }
+        top = mark;
+        uint16_t reg = target_register(dst);
+        emit(Opcode::CALL, reg, it->second, first);
+
+        // functions without a declared return type give integers
+        data_type type = SYMBOL_TABLE->getVariable(name).type;
+        return Value{reg, type == data_type::UNKNOWN ? data_type::INTEGER : type};
+    }
+};
+
+// FUNCTION : compile bytecode
+// - compiles a resolved program
+BytecodeProgram compile_bytecode(const AST_program* program){
+    BytecodeCompiler compiler;
+    return compiler.compile(program);
+}
+
+#endif // BYTECODE_HPP
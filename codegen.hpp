@@ -7,385 +7,872 @@
 #include <stack>
 #include <queue>
 #include <unordered_map>
-#include <fstream>
-#include <set>
+#include <algorithm>
 
 #include "ast.hpp"
 #include "parser.hpp"
 #include "lexer.hpp"
 #include "table.hpp"
+#include "emitter.hpp"
+#include "encoder.hpp"
+#include "ir.hpp"
+#include "regalloc.hpp"
+#include "x86.hpp"
 
 //------------------------------------------------------------------------------------------
 // Code Generator
 //------------------------------------------------------------------------------------------
 
-// REGISTER MANAGER
-// - Keeps track of free registers to use
-class RegisterManager {
-private:
-    std::set<std::string> freeRegisters;
+// TARGETS
+// - PE64 : Windows console program, exits through the ExitProcess import
+// - ELF64 : Linux executable, exits and writes through syscalls
+enum class Target { PE64, ELF64 };
+
+// OUTPUTS
+// - ASM : FASM source, <program>.asm
+// - EXE : a runnable executable encoded here without an assembler, <program>, ELF64 only
+// - JIT : nothing is written, ion run executes the code in memory, ELF64 only
+//         the program is then called like a function and returns instead of exiting
+// - INTERP : no machine code, ion run --interp compiles to bytecode and interprets it
+enum class Emit { ASM, EXE, JIT, INTERP };
+
+// Registers the SysV ABI expects a function to preserve, saved around a JIT-compiled program
+const Reg CALLEE_SAVED[] = {Reg::RBX, Reg::RBP, Reg::R12, Reg::R13, Reg::R14, Reg::R15};
+
+// LABELS OF THE ELF64 RUNTIME
+// - declared before the program so calls into the runtime can refer to them
+// - programReturn is the epilogue of a JIT-compiled program, where a runtime error unwinds to
+struct RuntimeLabels{
+    uint32_t writeInt, writeChar, writeBool, writeStr, divisionError;
+    uint32_t dataTrue, dataFalse, dataDivisionError;
+    uint32_t programReturn;
+};
 
-public:
-    RegisterManager() {
-        // Initialize with all available registers
-        freeRegisters = {"rax", "rbx", "rcx", "rdx", "rsi", "rdi", "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"};
+// RUNTIME ERRORS
+// - what a JIT-compiled program returns in eax, an executable writes the message and exits with status 1 instead
+enum class RuntimeError { NONE, DIVISION_BY_ZERO };
+
+const char* runtime_error_message(int error){
+    switch ((RuntimeError)error) {
+        case RuntimeError::NONE: return "";
+        case RuntimeError::DIVISION_BY_ZERO: return "Division by zero";
     }
+    return "Unknown runtime error";
+}
 
-    std::string getFreeRegister() {
-        if (freeRegisters.empty()) {
-            throw std::runtime_error("No free registers available");
-        }
-        std::string reg = *freeRegisters.begin();
-        freeRegisters.erase(freeRegisters.begin());
-        return reg;
+const char DIVISION_ERROR_TEXT[] = "Division by zero\n";
+
+// Output, instructions, target and optimization level of the compilation running on this thread
+thread_local AsmEmitter* asmOut = nullptr;
+thread_local InstrList* asmCode = nullptr;
+thread_local Target codegenTarget = Target::PE64;
+thread_local int codegenOptimize = 1;
+thread_local RuntimeLabels runtimeLabels;
+
+// ELF64 RUNTIME
+// - routines that write() calls into on Linux, each takes its argument in rdi
+// - they only touch rax, rcx, rdx, rsi, rdi and r11, register allocation keeps values that live across a call out of them
+// - a division by zero jumps to the error routine, which never returns to the program
+void write_elf64_runtime(Emit emit){
+    InstrList& code = *asmCode;
+    const Operand rax = op_reg(Reg::RAX), rcx = op_reg(Reg::RCX), rdx = op_reg(Reg::RDX);
+    const Operand rsi = op_reg(Reg::RSI), rdi = op_reg(Reg::RDI), rsp = op_reg(Reg::RSP);
+
+    // the write syscall, with the buffer in rsi and its length in rdx
+    auto sys_write = [&](){
+        code.emit(Op::MOV, op_reg(Reg::RAX, 4), op_imm(1));
+        code.note("sys_write");
+        code.emit(Op::MOV, op_reg(Reg::RDI, 4), op_imm(1));
+        code.note("stdout");
+        code.emit(Op::SYSCALL);
+    };
+
+    // signed decimal number, digits are built backwards in a stack buffer
+    uint32_t digit = code.new_label(".digit");
+    uint32_t write = code.new_label(".write");
+    code.place(runtimeLabels.writeInt);
+    code.emit(Op::SUB, rsp, op_imm(32));
+    code.emit(Op::LEA, rsi, op_mem(Reg::RSP, 32, 0));
+    code.emit(Op::MOV, rax, rdi);
+    code.emit(Op::MOV, rcx, op_imm(10));
+    code.emit(Op::TEST, rax, rax);
+    code.emit(Op::JNS, op_label(digit));
+    code.emit(Op::NEG, rax);
+    code.place(digit);
+    code.emit(Op::XOR, op_reg(Reg::RDX, 4), op_reg(Reg::RDX, 4));
+    code.emit(Op::DIV, rcx);
+    code.emit(Op::ADD, op_reg(Reg::RDX, 1), op_imm('0'));
+    code.emit(Op::DEC, rsi);
+    code.emit(Op::MOV, op_mem(Reg::RSI, 0, 1), op_reg(Reg::RDX, 1));
+    code.emit(Op::TEST, rax, rax);
+    code.emit(Op::JNZ, op_label(digit));
+    code.emit(Op::TEST, rdi, rdi);
+    code.emit(Op::JNS, op_label(write));
+    code.emit(Op::DEC, rsi);
+    code.emit(Op::MOV, op_mem(Reg::RSI, 0, 1), op_imm('-'));
+    code.place(write);
+    code.emit(Op::LEA, rdx, op_mem(Reg::RSP, 32, 0));
+    code.emit(Op::SUB, rdx, rsi);
+    sys_write();
+    code.emit(Op::ADD, rsp, op_imm(32));
+    code.emit(Op::RET);
+
+    // single character
+    code.place(runtimeLabels.writeChar);
+    code.emit(Op::PUSH, rdi);
+    code.emit(Op::MOV, rsi, rsp);
+    code.emit(Op::MOV, op_reg(Reg::RDX, 4), op_imm(1));
+    sys_write();
+    code.emit(Op::POP, rdi);
+    code.emit(Op::RET);
+
+    // TRUE or FALSE, spelled like the literals
+    write = code.new_label(".write");
+    code.place(runtimeLabels.writeBool);
+    code.emit(Op::MOV, rsi, op_label(runtimeLabels.dataTrue));
+    code.emit(Op::MOV, op_reg(Reg::RDX, 4), op_imm(4));
+    code.emit(Op::TEST, rdi, rdi);
+    code.emit(Op::JNZ, op_label(write));
+    code.emit(Op::MOV, rsi, op_label(runtimeLabels.dataFalse));
+    code.emit(Op::MOV, op_reg(Reg::RDX, 4), op_imm(5));
+    code.place(write);
+    sys_write();
+    code.emit(Op::RET);
+
+    // null-terminated string, rdx walks to the terminator and the length is the distance
+    uint32_t length = code.new_label(".length");
+    write = code.new_label(".write");
+    code.place(runtimeLabels.writeStr);
+    code.emit(Op::MOV, rsi, rdi);
+    code.emit(Op::MOV, rdx, rdi);
+    code.place(length);
+    code.emit(Op::CMP, op_mem(Reg::RDX, 0, 1), op_imm(0));
+    code.emit(Op::JE, op_label(write));
+    code.emit(Op::INC, rdx);
+    code.emit(Op::JMP, op_label(length));
+    code.place(write);
+    code.emit(Op::SUB, rdx, rsi);
+    sys_write();
+    code.emit(Op::RET);
+
+    // division by zero, a JIT-compiled program drops its frame and returns the error to ion run
+    code.place(runtimeLabels.divisionError);
+    if (emit == Emit::JIT) {
+        code.emit(Op::MOV, rsp, op_reg(Reg::RBP));
+        code.emit(Op::MOV, op_reg(Reg::RAX, 4), op_imm((int)RuntimeError::DIVISION_BY_ZERO));
+        code.emit(Op::JMP, op_label(runtimeLabels.programReturn));
+        return;
+    }
+    code.emit(Op::MOV, op_reg(Reg::RAX, 4), op_imm(1));
+    code.note("sys_write");
+    code.emit(Op::MOV, op_reg(Reg::RDI, 4), op_imm(2));
+    code.note("stderr");
+    code.emit(Op::MOV, rsi, op_label(runtimeLabels.dataDivisionError));
+    code.emit(Op::MOV, op_reg(Reg::RDX, 4), op_imm(sizeof(DIVISION_ERROR_TEXT) - 1));
+    code.emit(Op::SYSCALL);
+    code.emit(Op::MOV, op_reg(Reg::RAX, 4), op_imm(60));
+    code.note("sys_exit");
+    code.emit(Op::MOV, op_reg(Reg::RDI, 4), op_imm(1));
+    code.note("Exit code");
+    code.emit(Op::SYSCALL);
+}
+
+// Declare the data labels, string literal N gets label ID N
+void declare_data(Target target){
+    for (symbol_id literal : stringLiterals->literals) {
+        std::string bytes(SYMBOLS->name(literal));
+        bytes.push_back('\0');
+        asmCode->new_data(stringLiterals->label(literal), bytes);
     }
 
-    void releaseRegister(const std::string& reg) {
-        freeRegisters.insert(reg);
+    if (target == Target::ELF64) {
+        runtimeLabels.dataTrue = asmCode->new_data("ion_true", "TRUE");
+        runtimeLabels.dataFalse = asmCode->new_data("ion_false", "FALSE");
+        runtimeLabels.dataDivisionError = asmCode->new_data("ion_division_error_text", DIVISION_ERROR_TEXT);
+        runtimeLabels.writeInt = asmCode->new_label("ion_write_int");
+        runtimeLabels.writeChar = asmCode->new_label("ion_write_char");
+        runtimeLabels.writeBool = asmCode->new_label("ion_write_bool");
+        runtimeLabels.writeStr = asmCode->new_label("ion_write_str");
+        runtimeLabels.divisionError = asmCode->new_label("ion_division_error");
+        runtimeLabels.programReturn = asmCode->new_label("ion_return");
     }
-};
+}
 
-// Global variables declaration
-std::ofstream asmFile;
-RegisterManager regManager; 
-int GLOBAL_ADDRESS = 0;
+// Write all of the string literals
+void write_string_literals(){
+    for (symbol_id literal : stringLiterals->literals) {
+        std::string label = stringLiterals->label(literal);
 
-// GENERATE: Program
-// - Writes the assembly code for the program
-void generate_code(AST_program *program, std::string programName){
-    asmFile.open(programName + ".asm");
-    if (!asmFile) {
-        std::cerr << "Error opening file for writing." << std::endl;
+        // Write the string literal with its label
+        *asmOut << "    " << label << " db \"" << SYMBOLS->name(literal) << "\", 0" << "\n";
+
+        // Write the length of the string literal
+        *asmOut << "    " << label << "_len = $ - " << label << "\n";
+    }
+}
+
+// Writing the boilerplate for an empty FASM program, up to the code
+void write_header(Target target){
+    if (target == Target::ELF64) {
+        *asmOut << "format ELF64 executable 3\n";
+        *asmOut << "entry start\n\n";
+
+        *asmOut << "segment readable writeable\n";
+        *asmOut << "    ion_true db 'TRUE'\n";
+        *asmOut << "    ion_false db 'FALSE'\n";
+        *asmOut << "    ion_division_error_text db 'Division by zero', 10\n\n";
+        write_string_literals();
+
+        *asmOut << "segment readable executable\n";
         return;
     }
 
-    // Writing the boilerplate for an empty FASM program
-    asmFile << "format pe64 console\n";
-    asmFile << "entry start\n\n";
+    *asmOut << "format pe64 console\n";
+    *asmOut << "entry start\n\n";
 
-    asmFile << "STD_OUTPUT_HANDLE       = -11\n\n";
+    *asmOut << "STD_OUTPUT_HANDLE       = -11\n\n";
 
-    asmFile << "section '.data' data readable writeable\n";
-    asmFile << "    ; Data section goes here\n";
-    asmFile << "    dummy db 0  ; Placeholder to keep the section\n\n";
+    *asmOut << "section '.data' data readable writeable\n";
+    *asmOut << "    ; Data section goes here\n";
+    *asmOut << "    dummy db 0  ; Placeholder to keep the section\n\n";
+    write_string_literals();
 
-    // Write all of the string literals
-    for (const auto& pair : stringLiterals) {
-        // Write the string literal with its label
-        asmFile << "    " << pair.second << " db \"" << pair.first << "\", 0" << std::endl;
+    *asmOut << "section '.text' code readable executable\n";
+}
 
-        // Write the length of the string literal
-        asmFile << "    " << pair.second << "_len = $ - " << pair.second << std::endl;
+// Writing the exit and everything after it
+// - the ELF64 exit and runtime are instructions, the PE64 exit goes through the import table, which only FASM text has
+void write_footer(Target target, Emit emit){
+    if (emit == Emit::JIT) {
+        for (int i = (int)(sizeof(CALLEE_SAVED) / sizeof(CALLEE_SAVED[0])) - 1; i >= 0; i--) {
+            asmCode->emit(Op::POP, op_reg(CALLEE_SAVED[i]));
+        }
+        asmCode->emit(Op::RET);
+        write_elf64_runtime(emit);
+        return;
+    }
+    if (target == Target::ELF64) {
+        asmCode->emit(Op::MOV, op_reg(Reg::RAX, 4), op_imm(60));
+        asmCode->note("sys_exit");
+        asmCode->emit(Op::MOV, op_reg(Reg::RDI, 4), op_imm(0));
+        asmCode->note("Exit code");
+        asmCode->emit(Op::SYSCALL);
+        write_elf64_runtime(emit);
+        return;
     }
 
-    asmFile << "section '.text' code readable executable\n";
-    asmFile << "start:\n";
+    asmCode->emit(Op::MOV, op_reg(Reg::RCX, 4), op_imm(0));
+    asmCode->note("Exit code");
+}
+
+void write_pe64_imports(){
+    *asmOut << "    call [ExitProcess]\n\n";
+
+    *asmOut << "section '.idata' import data readable writeable\n";
+    *asmOut << "    dd      0,0,0,RVA kernel_name,RVA kernel_table\n";
+    *asmOut << "    dd      0,0,0,0,0\n\n";
 
-    asmFile << "    mov rbp, rsp    ; Set base pointer to the current stack pointer\n";
+    *asmOut << "kernel_table:\n";
+    *asmOut << "    ExitProcess     dq RVA _ExitProcess\n";
+    *asmOut << "    dq 0\n\n";
 
-    // Align scope_size to 16 bytes for stack alignment
-    int alignedScopeSize = (SYMBOL_TABLE->scope_size + 15) & ~15;
-    asmFile << "    sub rsp, " << alignedScopeSize << "  ; Allocate stack space for program. Size: " << SYMBOL_TABLE->scope_size << "\n";
-    GLOBAL_ADDRESS += alignedScopeSize;
+    *asmOut << "kernel_name     db 'KERNEL32.DLL',0\n\n";
 
-    for(auto child: program->expressions){
-        codeGenResult res = child->generate_code();
-        // if(child->type == AST_type::BOOLEAN ||
-        //    child->type == AST_type::INTEGER ||
-        //    child->type == AST_type::CHAR ||
-        //    child->type == AST_type::STRING ||
-        //    child->type == AST_type::FLOAT ||
-        //    child->type == AST_type::FUNCTION_CALL){
-        //         regManager.releaseRegister(res.registerName);
-        //    }
+    *asmOut << "_ExitProcess    db 0,0,'ExitProcess',0\n";
+}
 
-        regManager.releaseRegister(res.registerName);
+//-----------------------------------------------------------------------------------------------------------------------------
+// SECTION : LOWERING
+// - turns the IR into x86 instructions on virtual registers, each IR value gets one virtual register
+// - int, char and bool values are 32 bits wide in registers, strings 64, so int slots can be used as memory operands
+// - a load of an int used once in its own block, with no store in between, is not emitted: the instruction using it
+//   reads the stack slot itself (add r, [rbp - N]), constants become immediates wherever x86 takes one
+// - a value used for the last time becomes the destination of the instruction using it, two-address x86 needs no copy
+// - a comparison only used by the branch after it is a cmp and a conditional jump, jumps to the next block are dropped
+// - from -O1 multiplications and divisions by powers of two are shifts
+//-----------------------------------------------------------------------------------------------------------------------------
+
+// FUNCTION : power of two
+// - k for a constant operand of 2^k with k from 1 to 30, 0 for anything else
+int power_of_two(const IrOperand& o){
+    if (!o.is(IrOperand::Kind::CONST) || o.value < 2 || o.value > (1 << 30) || (o.value & (o.value - 1)) != 0) {
+        return 0;
+    }
+    int shift = 0;
+    while (((int64_t)1 << shift) < o.value) {
+        shift++;
     }
+    return shift;
+}
 
-    // Deallocate stack space
-    asmFile << "    add rsp, " << alignedScopeSize  << "  ; Deallocate stack space for program\n";
-    GLOBAL_ADDRESS -= alignedScopeSize;
+// CLASS : X86 lowering
+class X86Lowering{
+public:
+    void lower(const IrProgram& ir){
+        this->ir = &ir;
+        analyze();
+        values.assign(ir.values, Operand());
+
+        labels.assign(ir.blocks.size(), 0);
+        for (uint32_t b = 1; b < (uint32_t)ir.blocks.size(); b++) {
+            labels[b] = asmCode->new_label(".b" + std::to_string(b));
+        }
 
-    asmFile << "    mov ecx, 0  ; Exit code\n";
-    asmFile << "    call [ExitProcess]\n\n";
+        for (uint32_t b = 0; b < (uint32_t)ir.blocks.size(); b++) {
+            if (b != 0) {
+                asmCode->place(labels[b]);
+            }
+            current = b;
+            const std::vector<IrInstr>& code = ir.blocks[b].code;
+            for (size_t i = 0; i < code.size(); i++) {
+                // a comparison only the branch after it reads sets the flags for that branch
+                if (is_comparison(code[i].op) && i + 1 < code.size() && code[i + 1].op == IrOp::BR &&
+                    code[i + 1].a.is(IrOperand::Kind::VALUE) && code[i + 1].a.value == code[i].dst && uses[code[i].dst] == 1) {
+                    Op jump = compare(code[i]);
+                    branch(jump, inverse(jump), code[i + 1]);
+                    i++;
+                    continue;
+                }
+                lower(code[i]);
+            }
+        }
+    }
 
-    asmFile << "section '.idata' import data readable writeable\n";
-    asmFile << "    dd      0,0,0,RVA kernel_name,RVA kernel_table\n";
-    asmFile << "    dd      0,0,0,0,0\n\n";
+private:
+    const IrProgram* ir = nullptr;
+    std::vector<Operand> values;        // by IR value, its virtual register, or its stack slot when the load is folded
+    std::vector<uint32_t> uses;
+    std::vector<uint8_t> folded;        // loads the instruction using them reads from the stack slot
+    std::vector<symbol_id> variables;   // variable of a folded load, for the notes
+    std::vector<uint32_t> labels;       // by block, block 0 starts at the entry point
+    uint32_t current = 0;               // block being lowered
+
+    // FUNCTION : analyze
+    // - counts the uses of every value and finds the loads that can be folded into the instruction using them
+    // - a store, or the start of a block, between a load and its use keeps the load where it is
+    void analyze(){
+        const uint32_t NONE = UINT32_MAX;
+        uses.assign(ir->values, 0);
+        folded.assign(ir->values, 0);
+        variables.assign(ir->values, 0);
+        std::vector<uint32_t> loadedAfter(ir->values, NONE);    // stores before the load, NONE for other values
+        uint32_t stores = 0;
+
+        auto use = [&](const IrOperand& o){
+            if (o.is(IrOperand::Kind::VALUE)) {
+                uses[o.value]++;
+                folded[o.value] = loadedAfter[o.value] == stores;
+            }
+        };
+
+        for (const IrBlock& block : ir->blocks) {
+            stores++;
+            for (const IrInstr& in : block.code) {
+                use(in.a);
+                use(in.b);
+                if (in.op == IrOp::LOAD && in.type == data_type::INTEGER) {
+                    loadedAfter[in.dst] = stores;
+                    variables[in.dst] = in.a.name;
+                } else if (in.op == IrOp::STORE) {
+                    stores++;
+                }
+            }
+        }
+        for (uint32_t v = 0; v < ir->values; v++) {
+            folded[v] = folded[v] && uses[v] == 1;
+        }
+    }
 
-    asmFile << "kernel_table:\n";
-    asmFile << "    ExitProcess     dq RVA _ExitProcess\n";
-    asmFile << "    dq 0\n\n";
+    static bool is_comparison(IrOp op){
+        return op == IrOp::EQ || op == IrOp::NE || op == IrOp::LT || op == IrOp::LE || op == IrOp::GT || op == IrOp::GE;
+    }
 
-    asmFile << "kernel_name     db 'KERNEL32.DLL',0\n\n";
+    // Registers hold ints, chars and bools in 32 bits and the rest in 64
+    static int width(data_type type){
+        return type == data_type::INTEGER || type == data_type::CHAR || type == data_type::BOOLEAN ? 4 : 8;
+    }
 
-    asmFile << "_ExitProcess    db 0,0,'ExitProcess',0\n";
+    static Operand slot(const IrOperand& o, int size){
+        return op_mem(Reg::RBP, -o.value, size);
+    }
 
-    asmFile.close(); // Close the file
-}
+    // the x86 operand an IR operand is read from
+    Operand operand(const IrOperand& o) const {
+        switch (o.kind) {
+            case IrOperand::Kind::VALUE: return values[o.value];
+            case IrOperand::Kind::CONST: return op_imm(o.value);
+            case IrOperand::Kind::STRING: return op_label((uint32_t)o.value);
+            default: throw std::runtime_error("Operand cannot be read");
+        }
+    }
 
-codeGenResult CALL_write(AST_function_call *call){
-    codeGenResult res;
-    throw std::runtime_error("Function call not implemented yet");
-    return res;
-}
+    // Method to note the variable a folded load reads on the instruction reading it
+    bool note_load(const IrOperand& o){
+        if (o.is(IrOperand::Kind::VALUE) && folded[o.value]) {
+            asmCode->note("Use variable: " + std::string(SYMBOLS->name(variables[o.value])));
+            return true;
+        }
+        return false;
+    }
 
-codeGenResult CALL_read(AST_function_call *call){
-    codeGenResult res;
-    throw std::runtime_error("Function call not implemented yet");
-    return res;
-}
+    // a folded load copied into a register is no longer read from its slot, later instructions must not note it
+    void materialized(const IrOperand& o){
+        note_load(o);
+        if (o.is(IrOperand::Kind::VALUE)) {
+            folded[o.value] = 0;
+        }
+    }
 
-codeGenResult AST_integer::generate_code(){
-    std::string reg = regManager.getFreeRegister();
-    asmFile << "    mov " << reg << ", " << this->value << "\n";
-    codeGenResult res;
-    res.registerName = reg;
-    res.type = res_type::INTEGER;
-    return res;
-}
+    // a new virtual register holding an operand, unless it is in one already
+    Operand read(const IrOperand& o, int size){
+        Operand value = operand(o);
+        if (value.is(Operand::Kind::VREG)) {
+            return value;
+        }
+        Operand reg = op_vreg(asmCode->new_vreg(), size);
+        asmCode->emit(Op::MOV, reg, value);
+        materialized(o);
+        return reg;
+    }
 
-codeGenResult AST_boolean::generate_code(){
-    std::string reg = regManager.getFreeRegister();
-    if(this->value == true){
-        asmFile << "    mov " << reg << ", 1\n";
-    }else{
-        asmFile << "    mov " << reg << ", 0\n";
+    bool reusable(const IrOperand& o) const {
+        return o.is(IrOperand::Kind::VALUE) && uses[o.value] == 1 && values[o.value].is(Operand::Kind::VREG);
     }
 
-    codeGenResult res;
-    res.registerName = reg;
-    res.type = res_type::BOOLEAN;
-    return res;
-}
+    // the register an instruction computes into, the operand's own if this is its last use
+    Operand destination(const IrOperand& o, int size){
+        if (reusable(o)) {
+            return values[o.value];
+        }
+        Operand reg = op_vreg(asmCode->new_vreg(), size);
+        asmCode->emit(Op::MOV, reg, operand(o));
+        materialized(o);
+        return reg;
+    }
 
-codeGenResult AST_float::generate_code(){
-    codeGenResult res;
-    throw std::runtime_error("Float not implemented yet");
-    return res;
-}
+    void lower(const IrInstr& in){
+        switch (in.op) {
+            case IrOp::LOAD:
+                load(in);
+                break;
+            case IrOp::STORE:
+                store(in);
+                break;
+            case IrOp::COPY: {
+                if (!values[in.dst].is(Operand::Kind::VREG)) {
+                    values[in.dst] = op_vreg(asmCode->new_vreg(), width(in.type));
+                }
+                asmCode->emit(Op::MOV, values[in.dst], operand(in.a));
+                note_load(in.a);
+                break;
+            }
+            case IrOp::ADD:
+            case IrOp::SUB:
+            case IrOp::MUL:
+                arithmetic(in);
+                break;
+            case IrOp::DIV:
+            case IrOp::MOD:
+                division(in);
+                break;
+            case IrOp::NEG:
+            case IrOp::NOT: {
+                Operand dst = destination(in.a, 4);
+                if (in.op == IrOp::NEG) {
+                    asmCode->emit(Op::NEG, dst);
+                } else {
+                    asmCode->emit(Op::XOR, dst, op_imm(1));
+                }
+                values[in.dst] = dst;
+                break;
+            }
+            case IrOp::EQ:
+            case IrOp::NE:
+            case IrOp::LT:
+            case IrOp::LE:
+            case IrOp::GT:
+            case IrOp::GE: {
+                // mov leaves the flags alone, setcc only writes the low byte
+                Operand dst = op_vreg(asmCode->new_vreg(), 4);
+                asmCode->emit(Op::MOV, dst, op_imm(0));
+                Op jump = compare(in);
+                asmCode->emit(set_on(jump), op_vreg(dst.label, 1));
+                values[in.dst] = dst;
+                break;
+            }
+            case IrOp::WRITE:
+                write(in);
+                break;
+            case IrOp::JMP:
+                if (in.target != current + 1) {
+                    asmCode->emit(Op::JMP, op_label(labels[in.target]));
+                }
+                break;
+            case IrOp::BR: {
+                Operand condition = operand(in.a);
+                if (condition.is(Operand::Kind::IMM)) {
+                    uint32_t target = condition.value != 0 ? in.target : in.otherwise;
+                    if (target != current + 1) {
+                        asmCode->emit(Op::JMP, op_label(labels[target]));
+                    }
+                    break;
+                }
+                if (condition.is(Operand::Kind::LABEL)) {
+                    condition = read(in.a, 8);
+                }
+                if (condition.is(Operand::Kind::MEM)) {
+                    asmCode->emit(Op::CMP, condition, op_imm(0));
+                    note_load(in.a);
+                } else {
+                    asmCode->emit(Op::TEST, condition, condition);
+                }
+                branch(Op::JNZ, Op::JE, in);
+                break;
+            }
+            case IrOp::RET:
+                // the exit follows the last block
+                break;
+        }
+    }
 
-codeGenResult AST_char::generate_code(){
-    std::string reg = regManager.getFreeRegister();
-    asmFile << "    mov " << reg << ", '" << this->value << "'\n";
-    codeGenResult res; 
-    res.registerName = reg;
-    res.type = res_type::CHAR;
-    return res; 
-}
+    void load(const IrInstr& in){
+        if (folded[in.dst]) {
+            values[in.dst] = slot(in.a, 4);
+            return;
+        }
+        Operand dst = op_vreg(asmCode->new_vreg(), width(in.type));
+        if (in.type == data_type::CHAR || in.type == data_type::BOOLEAN) {
+            asmCode->emit(Op::MOVZX, dst, slot(in.a, 1));
+        } else {
+            asmCode->emit(Op::MOV, dst, slot(in.a, ir_type_size(in.type)));
+        }
+        asmCode->note("Use variable: " + std::string(SYMBOLS->name(in.a.name)));
+        values[in.dst] = dst;
+    }
 
-codeGenResult AST_string::generate_code(){
-    codeGenResult res;
-    auto it = stringLiterals.find(this->value);
-    if(it != stringLiterals.end()){
-        res.type = res_type::STRING;
-        res.registerName = it->second;
-    }else{
-        throw std::runtime_error("String literal not found in stringLiterals map");
+    // a constant is stored as an immediate, a value from its register, there is no store of a label's address
+    void store(const IrInstr& in){
+        int size = ir_type_size(in.type);
+        Operand value = operand(in.b);
+        if (value.is(Operand::Kind::MEM) || value.is(Operand::Kind::LABEL)) {
+            value = read(in.b, width(in.type));
+        }
+        if (value.is(Operand::Kind::VREG)) {
+            value.size = (uint8_t)size;
+        }
+        asmCode->emit(Op::MOV, slot(in.a, size), value);
+        asmCode->note("Assign variable: " + std::string(SYMBOLS->name(in.a.name)));
     }
 
-    return res;
-}
+    // x * constant is the three-operand imul, straight from the stack slot when x is a folded load
+    void arithmetic(const IrInstr& in){
+        IrOperand a = in.a;
+        IrOperand b = in.b;
+        bool commutative = in.op != IrOp::SUB;
 
-codeGenResult AST_variable::generate_code(){
-    metadata data = SYMBOL_TABLE->getVariable(this->name);
-    std::string reg = regManager.getFreeRegister();
-    int trueAddress;
-    if(data.relative_address == -1){ // Declaration
-        trueAddress = GLOBAL_ADDRESS - (data.address + data.size);
-        SYMBOL_TABLE->set_relativeAddress(this->name, trueAddress);
-
-        // Calculate the variable's address and load its value into the register
-        asmFile << "    mov " << reg << ", [rbp - " << trueAddress << "]" << "; Declare variable: " << this->name << std::endl;
-    }else{
-        trueAddress = data.relative_address;
-
-        // Calculate the variable's address and load its value into the register
-        asmFile << "    mov " << reg << ", [rbp - " << trueAddress << "]" << "; Use variable: " << this->name << std::endl;
-    }
-
-    codeGenResult res;
-    res.registerName = reg;
-    if(data.type == data_type::INTEGER){
-        res.type = res_type::VAR_INTEGER;
-    }else if(data.type == data_type::BOOLEAN){
-        res.type = res_type::VAR_BOOLEAN;
-    }else if(data.type == data_type::CHAR){
-        res.type = res_type::VAR_CHAR;
-    }else if(data.type == data_type::STRING){
-        res.type = res_type::VAR_STRING;
-    }else if(data.type == data_type::FLOAT){
-        res.type = res_type::VAR_FLOAT;
-    }else if(data.type == data_type::UNKNOWN){
-        res.type = res_type::VAR_UNKNOWN;
-    }
-
-    return res;
-}
+        if (in.op == IrOp::MUL) {
+            if (power_of_two(a) && codegenOptimize > 0) {
+                std::swap(a, b);
+            }
+            if (int shift = codegenOptimize > 0 ? power_of_two(b) : 0) {
+                Operand dst = destination(a, 4);
+                asmCode->emit(Op::SHL, dst, op_imm(shift));
+                values[in.dst] = dst;
+                return;
+            }
+            if (a.is(IrOperand::Kind::CONST) && !b.is(IrOperand::Kind::CONST)) {
+                std::swap(a, b);
+            }
+            if (b.is(IrOperand::Kind::CONST)) {
+                Operand source = a.is(IrOperand::Kind::CONST) ? read(a, 4) : operand(a);
+                Operand dst = reusable(a) ? source : op_vreg(asmCode->new_vreg(), 4);
+                asmCode->emit(Op::IMUL_IMM, dst, source, (int32_t)b.value);
+                note_load(a);
+                values[in.dst] = dst;
+                return;
+            }
+        }
 
-codeGenResult AST_unary::generate_code(){
-    codeGenResult res;
-    throw std::runtime_error("Unary not implemented yet");
-    return res;
-}
+        // the side that can be computed into goes first
+        if (commutative && !reusable(a) && reusable(b)) {
+            std::swap(a, b);
+        }
+        Operand dst = destination(a, 4);
+        Operand source = operand(b);
+        Op op = in.op == IrOp::ADD ? Op::ADD : in.op == IrOp::SUB ? Op::SUB : Op::IMUL;
+        asmCode->emit(op, dst, source);
+        note_load(b);
+        values[in.dst] = dst;
+    }
 
-codeGenResult AST_binary::generate_code(){
-    // Generate code for LHS and RHS, and get the registers they use
-    codeGenResult lhsReg = LHS->generate_code();
-    codeGenResult rhsReg = RHS->generate_code();
-
-    // Check the operation and perform it
-    if (op == "+") {
-        if((lhsReg.type == res_type::INTEGER || lhsReg.type == res_type::VAR_INTEGER) && 
-            (rhsReg.type == res_type::INTEGER || rhsReg.type == res_type::VAR_INTEGER)
-        ){
-            asmFile << "    add " << lhsReg.registerName << ", " << rhsReg.registerName << "\n";
-        }else{
-            throw std::runtime_error("Unsupported operation + on non-integer types");
-        }
-    } else if (op == "-") {
-        if((lhsReg.type == res_type::INTEGER || lhsReg.type == res_type::VAR_INTEGER) && 
-            (rhsReg.type == res_type::INTEGER || rhsReg.type == res_type::VAR_INTEGER)
-        ){
-            asmFile << "    sub " << lhsReg.registerName << ", " << rhsReg.registerName << "\n";
-        }else{
-            throw std::runtime_error("Unsupported operation - on non-integer types");
-        }
-    } else if (op == "*"){
-        if((lhsReg.type == res_type::INTEGER || lhsReg.type == res_type::VAR_INTEGER) && 
-            (rhsReg.type == res_type::INTEGER || rhsReg.type == res_type::VAR_INTEGER)
-        ){
-            asmFile << "    imul " << lhsReg.registerName << ", " << rhsReg.registerName << "\n";
-        }else{
-            throw std::runtime_error("Unsupported operation * on non-integer types");
-        }
-    } else if (op == "/"){
-        if((lhsReg.type == res_type::INTEGER || lhsReg.type == res_type::VAR_INTEGER) && 
-            (rhsReg.type == res_type::INTEGER || rhsReg.type == res_type::VAR_INTEGER)
-        ){
-            asmFile << "    mov rax, " << lhsReg.registerName << "\n";
-            asmFile << "    cqo\n";
-            asmFile << "    idiv " << rhsReg.registerName << "\n";
-            asmFile << "    mov " << lhsReg.registerName << ", rax\n";
-        }else{
-            throw std::runtime_error("Unsupported operation / on non-integer types");
-        }
-    } else if (op == "%"){
-        if((lhsReg.type == res_type::INTEGER || lhsReg.type == res_type::VAR_INTEGER) && 
-            (rhsReg.type == res_type::INTEGER || rhsReg.type == res_type::VAR_INTEGER)
-        ){
-            asmFile << "    mov rax, " << lhsReg.registerName << "\n";
-            asmFile << "    cqo\n";
-            asmFile << "    idiv " << rhsReg.registerName << "\n";
-            asmFile << "    mov " << lhsReg.registerName << ", rdx\n";
-        }else{
-            throw std::runtime_error("Unsupported operation % on non-integer types");
-        }
-    } else if (op == "="){
-         // Ensure LHS is a variable
-        if (LHS->type != AST_type::VARIABLE) {
-            throw std::runtime_error("Left-hand side of assignment must be a variable");
-        }
-
-        // Ensure LHS and RHS are the same type
-        if((lhsReg.type == res_type::VAR_INTEGER && (rhsReg.type == res_type::INTEGER || rhsReg.type == res_type::VAR_INTEGER))||
-            (lhsReg.type == res_type::VAR_BOOLEAN && (rhsReg.type == res_type::BOOLEAN || rhsReg.type == res_type::VAR_BOOLEAN))||
-            (lhsReg.type == res_type::VAR_CHAR && (rhsReg.type == res_type::CHAR || rhsReg.type == res_type::VAR_CHAR))||
-            (lhsReg.type == res_type::VAR_STRING && (rhsReg.type == res_type::STRING || rhsReg.type == res_type::VAR_STRING))||
-            (lhsReg.type == res_type::VAR_FLOAT && (rhsReg.type == res_type::FLOAT || rhsReg.type == res_type::VAR_FLOAT))
-        ){
-            // Do nothing
-        }else if(lhsReg.type == res_type::VAR_UNKNOWN){
-            metadata data = SYMBOL_TABLE->getVariable(dynamic_cast<AST_variable*>(LHS)->name);
-            if(rhsReg.type == res_type::INTEGER){
-                data.type = data_type::INTEGER;
-            }else if(rhsReg.type == res_type::BOOLEAN){
-                data.type = data_type::BOOLEAN;
-            }else if(rhsReg.type == res_type::CHAR){
-                data.type = data_type::CHAR;
-            }else if(rhsReg.type == res_type::STRING){
-                data.type = data_type::STRING;
-            }else if(rhsReg.type == res_type::FLOAT){
-                data.type = data_type::FLOAT;
+    // x / 2^k and x % 2^k go through x + bias, where the bias is 2^k - 1 for a negative x and 0 otherwise,
+    // so they round toward zero like idiv, which takes its dividend in eax and leaves the remainder in edx
+    void division(const IrInstr& in){
+        if (int shift = codegenOptimize > 0 ? power_of_two(in.b) : 0) {
+            Operand dst = destination(in.a, 4);
+            Operand bias = op_vreg(asmCode->new_vreg(), 4);
+            asmCode->emit(Op::MOV, bias, dst);
+            asmCode->emit(Op::SAR, bias, op_imm(31));
+            asmCode->emit(Op::SHR, bias, op_imm(32 - shift));
+            asmCode->emit(Op::ADD, bias, dst);
+            if (in.op == IrOp::DIV) {
+                asmCode->emit(Op::SAR, bias, op_imm(shift));
+                values[in.dst] = bias;
+            } else {
+                asmCode->emit(Op::AND, bias, op_imm(-((int64_t)1 << shift)));
+                asmCode->emit(Op::SUB, dst, bias);
+                values[in.dst] = dst;
             }
-        }else{
-            throw std::runtime_error("Unsupported operation = on non-matching types");
+            return;
         }
 
-        // Store the RHS value into the LHS variable's location
-        asmFile << "    mov " << lhsReg.registerName << ", " << rhsReg.registerName << std::endl;
+        // idiv faults on INT_MIN / -1, where the result wraps like everywhere else: x / -1 is -x and x % -1 is 0
+        bool constant = in.b.is(IrOperand::Kind::CONST);
+        if (constant && in.b.value == -1) {
+            if (in.op == IrOp::DIV) {
+                values[in.dst] = destination(in.a, 4);
+                asmCode->emit(Op::NEG, values[in.dst]);
+            } else {
+                values[in.dst] = op_vreg(asmCode->new_vreg(), 4);
+                asmCode->emit(Op::MOV, values[in.dst], op_imm(0));
+            }
+            return;
+        }
 
-        // Store the LHS value into the variable's location
-        metadata data = SYMBOL_TABLE->getVariable(dynamic_cast<AST_variable*>(LHS)->name);
-        asmFile << "    mov [rsp + " << data.address << "], " << lhsReg.registerName << std::endl;
+        // idiv has no immediate form
+        Operand divisor = constant ? read(in.b, 4) : operand(in.b);
+        Operand dividend = operand(in.a);
+        Operand dst = reusable(in.a) ? dividend : op_vreg(asmCode->new_vreg(), 4);
+        Reg result = in.op == IrOp::DIV ? Reg::RAX : Reg::RDX;
+
+        // a zero divisor stops the program through the runtime, which only the elf64 target has
+        if (codegenTarget == Target::ELF64 && !(constant && in.b.value != 0)) {
+            if (divisor.is(Operand::Kind::MEM)) {
+                asmCode->emit(Op::CMP, divisor, op_imm(0));
+                note_load(in.b);
+            } else {
+                asmCode->emit(Op::TEST, divisor, divisor);
+            }
+            asmCode->emit(Op::JE, op_label(runtimeLabels.divisionError));
+        }
+
+        asmCode->emit(Op::MOV, op_reg(Reg::RAX, 4), dividend);
+        note_load(in.a);
+        uint32_t negate = 0, done = 0;
+        if (!constant) {
+            negate = asmCode->new_label(".negate" + std::to_string(in.dst));
+            done = asmCode->new_label(".divided" + std::to_string(in.dst));
+            asmCode->emit(Op::CMP, divisor, op_imm(-1));
+            note_load(in.b);
+            asmCode->emit(Op::JE, op_label(negate));
+        }
+        asmCode->emit(Op::CDQ);
+        asmCode->emit(Op::IDIV, divisor);
+        note_load(in.b);
+        if (!constant) {
+            asmCode->emit(Op::JMP, op_label(done));
+            asmCode->place(negate);
+            if (in.op == IrOp::DIV) {
+                asmCode->emit(Op::NEG, op_reg(Reg::RAX, 4));
+            } else {
+                asmCode->emit(Op::XOR, op_reg(Reg::RDX, 4), op_reg(Reg::RDX, 4));
+            }
+            asmCode->place(done);
+        }
+        asmCode->emit(Op::MOV, dst, op_reg(result, 4));
+        values[in.dst] = dst;
+    }
+
+    // FUNCTION : compare
+    // - sets the flags for a comparison, returns the jump taken when it holds
+    // - cmp takes no immediate on the left, a constant there trades places with the other side
+    Op compare(const IrInstr& in){
+        static const Op jumps[] = {Op::JE, Op::JNZ, Op::JL, Op::JLE, Op::JG, Op::JGE};
+        static const Op swapped[] = {Op::JE, Op::JNZ, Op::JG, Op::JGE, Op::JL, Op::JLE};
+        int index = (int)in.op - (int)IrOp::EQ;
+        int size = width(in.type);
+
+        IrOperand left = in.a;
+        IrOperand right = in.b;
+        Op jump = jumps[index];
+        if (left.is(IrOperand::Kind::CONST) && !right.is(IrOperand::Kind::CONST)) {
+            std::swap(left, right);
+            jump = swapped[index];
+        }
+        Operand a = operand(left);
+        Operand b = operand(right);
+        if (a.is(Operand::Kind::IMM) || a.is(Operand::Kind::LABEL) || (a.is(Operand::Kind::MEM) && b.is(Operand::Kind::MEM))) {
+            a = read(left, size);
+        }
+        if (b.is(Operand::Kind::LABEL)) {
+            b = read(right, size);
+        }
+        asmCode->emit(Op::CMP, a, b);
+        note_load(left) || note_load(right);
+        return jump;
     }
 
-    // Release the RHS register as it's no longer needed
-    regManager.releaseRegister(rhsReg.registerName);
+    static Op inverse(Op jump){
+        switch (jump) {
+            case Op::JE: return Op::JNZ;
+            case Op::JNZ: return Op::JE;
+            case Op::JL: return Op::JGE;
+            case Op::JGE: return Op::JL;
+            case Op::JLE: return Op::JG;
+            default: return Op::JLE;
+        }
+    }
 
-    // Return the register holding the result (usually lhsReg)
+    static Op set_on(Op jump){
+        switch (jump) {
+            case Op::JE: return Op::SETE;
+            case Op::JNZ: return Op::SETNE;
+            case Op::JL: return Op::SETL;
+            case Op::JLE: return Op::SETLE;
+            case Op::JG: return Op::SETG;
+            default: return Op::SETGE;
+        }
+    }
 
-    return lhsReg;
-}
+    // Method to jump on the flags, falling through to whichever target is the next block
+    void branch(Op jump, Op inverse, const IrInstr& in){
+        if (in.target == current + 1) {
+            asmCode->emit(inverse, op_label(labels[in.otherwise]));
+            return;
+        }
+        asmCode->emit(jump, op_label(labels[in.target]));
+        if (in.otherwise != current + 1) {
+            asmCode->emit(Op::JMP, op_label(labels[in.otherwise]));
+        }
+    }
 
-codeGenResult AST_block::generate_code(){
-    SYMBOL_TABLE = SYMBOL_TABLE->traverseIN();
+    // each argument is written through the runtime routine for its type, which takes it in rdi
+    void write(const IrInstr& in){
+        if (codegenTarget != Target::ELF64) {
+            throw std::runtime_error("Function call not implemented yet");
+        }
+        Operand value = operand(in.a);
+        uint32_t routine;
+        if (in.type == data_type::INTEGER) {
+            routine = runtimeLabels.writeInt;
+            asmCode->emit(value.is(Operand::Kind::IMM) ? Op::MOV : Op::MOVSXD, op_reg(Reg::RDI), value);
+            note_load(in.a);
+        } else if (in.type == data_type::STRING) {
+            routine = runtimeLabels.writeStr;
+            asmCode->emit(Op::MOV, op_reg(Reg::RDI), value);
+        } else {
+            routine = in.type == data_type::CHAR ? runtimeLabels.writeChar : runtimeLabels.writeBool;
+            asmCode->emit(Op::MOV, op_reg(Reg::RDI, 4), value);
+        }
+        asmCode->emit(Op::CALL, op_label(routine));
+    }
+};
 
-    // ALLOCATE STACK SPACE FOR BLOCK
-    int alignedScopeSize = (SYMBOL_TABLE->scope_size + 15) & ~15;
-    asmFile << "    sub rsp, " << alignedScopeSize << "  ; Allocate stack space for block. Size: " << SYMBOL_TABLE->scope_size << "\n";
-    GLOBAL_ADDRESS += alignedScopeSize;
+// SELECTED CODE
+// - the entry point and the spill area of a program whose instructions are still on virtual registers
+struct SelectedCode{
+    uint32_t start;
+    SpillArea spills;
+};
 
-    for(auto child: this->children){
-        child->generate_code();
+// SELECT: Program
+// - Lowers the IR of a program to an instruction list in asmCode on virtual registers
+// - optimize is the -O level, from 1 up multiplications and divisions by powers of two become shifts
+SelectedCode select_instructions(const IrProgram& ir, Target target, Emit emit, int optimize = 1){
+    if (emit != Emit::ASM && target != Target::ELF64) {
+        throw std::runtime_error("Executables can only be written for the elf64 target");
+    }
+    asmCode->clear();
+    codegenTarget = target;
+    codegenOptimize = optimize;
+
+    declare_data(target);
+    SelectedCode selected;
+    selected.start = asmCode->new_label("start");
+    asmCode->place(selected.start);
+
+    if (emit == Emit::JIT) {
+        for (Reg reg : CALLEE_SAVED) {
+            asmCode->emit(Op::PUSH, op_reg(reg));
+        }
     }
 
-    // DEALLOCATE STACK SPACE FOR BLOCK
-    asmFile << "    add rsp, " << alignedScopeSize  << "  ; Deallocate stack space for block\n";
-    GLOBAL_ADDRESS -= alignedScopeSize;
+    // the spill slots sit above the base pointer, their size is only known after register allocation
+    selected.spills.reserve = (uint32_t)asmCode->code.size();
+    asmCode->emit(Op::SUB, op_reg(Reg::RSP), op_imm(0));
+    asmCode->note("Allocate spill slots");
 
-    SYMBOL_TABLE = SYMBOL_TABLE->traverseOUT();
+    asmCode->emit(Op::MOV, op_reg(Reg::RBP), op_reg(Reg::RSP));
+    asmCode->note("Set base pointer to the current stack pointer");
 
-    codeGenResult res;
-    res.type = res_type::VOID;
-    return res;
-}
+    // the slots of every scope at once, the frame stays 16-byte aligned
+    asmCode->emit(Op::SUB, op_reg(Reg::RSP), op_imm(ir.frameSize));
+    asmCode->note("Allocate stack space for program. Size: " + std::to_string(ir.frameSize));
 
-codeGenResult AST_conditional::generate_code(){
-    codeGenResult res;
-    throw std::runtime_error("Conditional not implemented yet");
-    return res;
-}
+    X86Lowering lowering;
+    lowering.lower(ir);
 
-codeGenResult AST_loop::generate_code(){
-    codeGenResult res;
-    throw std::runtime_error("Loop not implemented yet");
-    return res;
+    // Deallocate stack space
+    asmCode->emit(Op::ADD, op_reg(Reg::RSP), op_imm(ir.frameSize));
+    asmCode->note("Deallocate stack space for program");
+
+    // a JIT-compiled program returns 0, a runtime error arrives at the return label with its number in eax
+    if (emit == Emit::JIT) {
+        asmCode->emit(Op::MOV, op_reg(Reg::RAX, 4), op_imm((int)RuntimeError::NONE));
+        asmCode->place(runtimeLabels.programReturn);
+    }
+
+    selected.spills.release = (uint32_t)asmCode->code.size();
+    asmCode->emit(Op::ADD, op_reg(Reg::RSP), op_imm(0));
+    asmCode->note("Deallocate spill slots");
+
+    write_footer(target, emit);
+    return selected;
 }
 
-codeGenResult AST_function::generate_code(){
-    codeGenResult res;
-    throw std::runtime_error("Function not implemented yet");
-    return res;
+// BUILD: Program
+// - Builds the instruction list for the program in asmCode and allocates its registers, returns the label of the entry point
+uint32_t build_code(AST_program *program, Target target, Emit emit, int optimize = 1){
+    SelectedCode selected = select_instructions(build_ir(program), target, emit, optimize);
+    allocate_registers(*asmCode, selected.spills);
+    return selected.start;
 }
 
-codeGenResult AST_function_call::generate_code(){
-    if(this->function_name == "write"){
-        return CALL_write(this);
-    }else if(this->function_name == "read"){
-        return CALL_read(this);
+// WRITE: Program
+// - Writes a built instruction list as FASM source or as an executable
+void write_code(uint32_t start, const std::string& programName, Target target, Emit emit){
+    if (emit == Emit::JIT) {
+        throw std::runtime_error("JIT programs are run with ion run, not written");
     }
 
-    codeGenResult res;
-    throw std::runtime_error("Function call not implemented yet");
-    return res;
+    if (emit == Emit::EXE) {
+        if (!write_elf64_executable(*asmCode, start, programName)) {
+            std::cerr << "Error opening file for writing." << std::endl;
+        }
+        return;
+    }
+
+    asmOut->clear();
+    write_header(target);
+    print_fasm(*asmCode, *asmOut);
+    if (target == Target::PE64) {
+        write_pe64_imports();
+    }
+
+    // Write the whole program out at once
+    if (!asmOut->write_file(programName + ".asm")) {
+        std::cerr << "Error opening file for writing." << std::endl;
+    }
 }
 
-codeGenResult AST_return::generate_code(){
-    codeGenResult res;
-    throw std::runtime_error("Return not implemented yet");
-    return res;
+// GENERATE: Program
+// - Builds the instruction list for the program, then writes it
+void generate_code(AST_program *program, std::string programName, Target target = Target::PE64, Emit emit = Emit::ASM, int optimize = 1){
+    if (emit == Emit::JIT) {
+        throw std::runtime_error("JIT programs are run with ion run, not written");
+    }
+    write_code(build_code(program, target, emit, optimize), programName, target, emit);
 }
 
 
-#endif // CODEGEN_HPP
\ No newline at end of file
+#endif // CODEGEN_HPP
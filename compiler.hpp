@@ -2,29 +2,139 @@
 #define COMPILER_HPP
 
 #include <iostream>
+#include <memory>
 #include <string>
+#include <string_view>
 
 #include "ast.hpp"
 #include "parser.hpp"
 #include "table.hpp"
+#include "resolve.hpp"
+#include "optimize.hpp"
+#include "ir.hpp"
 #include "codegen.hpp"
+#include "context.hpp"
+#include "jit.hpp"
+#include "bytecode.hpp"
+#include "interpreter.hpp"
+#include "timing.hpp"
 
 /*
     This file will contain the main logic of the compiler. 
     Lexical -> Syntactic -> Semantic -> Code Generation 
 */
 
-void compile(char *programName,std::string code){
+// DUMP OPTIONS
+// - debugging dumps requested on the command line, all off by default
+struct DumpOptions{
+    bool tokens = false;
+    bool ast = false;
+    bool symbols = false;
+    bool bytecode = false;      // only when the program is interpreted
+    bool ir = false;            // only when the program is compiled to native code
 
-    AST_program *program = parse_program(code);
-    program->print();
-    std::cout << std::endl;
-    SYMBOL_TABLE->printSymbolTable();
+    bool any() const {
+        return tokens || ast || symbols || bytecode || ir;
+    }
+};
+
+// FUNCTION : compile
+// - compiles one program in its own context, the requested dumps go to out
+// - each stage is bracketed in the time report, which only measures when it is enabled
+// - with Emit::JIT or Emit::INTERP the program is run in this process instead of written, its time is the "run" phase
+// - optimize is the -O level, 0 compiles the tree as it was parsed
+// - safe to call from several threads at once for different programs, except when running them
+void compile(const char *programName, std::string_view code, const DumpOptions& dumps, Target target, Emit emit, int optimize, std::ostream& out, TimeReport& report){
+    CompilerContext context;
+
+    if(dumps.tokens){
+        dump_tokens(code, out);
+        context.lexStats.print(out);
+    }
+
+    report.begin("lex");
+    TokenStream ts(code);
+    report.end(ts.size(), "tokens");
+
+    // the program owns the node table of the whole tree, releasing it frees every node at once
+    report.begin("parse");
+    std::unique_ptr<AST_program> program(parse_program(ts));
+    long long nodes = (long long)program->size();
+    report.end(nodes, "nodes");
+
+    if(dumps.ast){
+        program->print(out);
+        out << "\n";
+    }
+    if(dumps.symbols){
+        context.globals.printSymbolTable(out);
+    }
 
     //remove the .ion in the program name
     std::string programNameString(programName);
     programNameString = programNameString.substr(0,programNameString.length()-4);
-    generate_code(program, programNameString);
+    report.begin("resolve");
+    resolve(program.get(), &context.globals);
+    report.end(nodes, "nodes");
+
+    if(optimize > 0){
+        report.begin("optimize");
+        long long replaced = optimize_program(program.get());
+        report.end(replaced, "folds");
+    }
+
+    if(emit == Emit::INTERP){
+        report.begin("bytecode");
+        BytecodeProgram bytecode = compile_bytecode(program.get());
+        report.end(bytecode.code.size(), "instrs");
+        if(dumps.bytecode){
+            bytecode.print(out);
+        }
+
+        out.flush();
+        std::cout.flush();
+        report.begin("run");
+        Interpreter(bytecode).run();
+        report.end(0, "");
+        return;
+    }
+
+    report.begin("ir");
+    IrProgram ir = build_ir(program.get());
+    report.end(ir.size(), "instrs");
+    if(dumps.ir){
+        ir.print(out);
+    }
+
+    report.begin("codegen");
+    SelectedCode selected = select_instructions(ir, target, emit, optimize);
+    report.end(asmCode->code.size(), "instrs");
+
+    report.begin("regalloc");
+    AllocationStats allocation = allocate_registers(*asmCode, selected.spills);
+    report.end(allocation.intervals, "vregs");
+    uint32_t start = selected.start;
+
+    if(emit == Emit::JIT){
+        report.begin("jit");
+        JitProgram jit(*asmCode, start);
+        report.end(jit.code_size(), "bytes");
+
+        // the program writes straight to file descriptor 1
+        out.flush();
+        std::cout.flush();
+        report.begin("run");
+        int error = jit.run();
+        report.end(0, "");
+        if(error != 0){
+            throw std::runtime_error(runtime_error_message(error));
+        }
+        return;
+    }
+
+    report.begin("emit");
+    write_code(start, programNameString, target, emit);
+    report.end(asmCode->code.size(), "instrs");
 }
 
 
@@ -0,0 +1,48 @@
+#ifndef CONTEXT_HPP
+#define CONTEXT_HPP
+
+#include "intern.hpp"
+#include "lexer.hpp"
+#include "table.hpp"
+#include "codegen.hpp"
+#include "emitter.hpp"
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// SECTION : COMPILER CONTEXT
+//-----------------------------------------------------------------------------------------------------------------------------
+
+// CLASS : Compiler context
+// - owns all the state of one compilation, so independent files can be compiled on separate threads
+// - the passes reach it through thread-local pointers, which it sets for its lifetime on the constructing thread
+class CompilerContext{
+public:
+    Interner symbols;
+    LexerStats lexStats;
+    Table globals;
+    StringLiteralTable literals;
+    AsmEmitter assembly;
+    InstrList code;
+
+    CompilerContext(){
+        SYMBOLS = &symbols;
+        LEX_STATS = &lexStats;
+        SYMBOL_TABLE = &globals;
+        stringLiterals = &literals;
+        asmOut = &assembly;
+        asmCode = &code;
+    }
+
+    CompilerContext(const CompilerContext&) = delete;
+    CompilerContext& operator=(const CompilerContext&) = delete;
+
+    ~CompilerContext(){
+        SYMBOLS = nullptr;
+        LEX_STATS = nullptr;
+        SYMBOL_TABLE = nullptr;
+        stringLiterals = nullptr;
+        asmOut = nullptr;
+        asmCode = nullptr;
+    }
+};
+
+#endif // CONTEXT_HPP
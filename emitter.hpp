@@ -0,0 +1,132 @@
+#ifndef EMITTER_HPP
+#define EMITTER_HPP
+
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ION_HAS_POSIX_IO 1
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// SECTION : ASSEMBLY EMITTER
+//-----------------------------------------------------------------------------------------------------------------------------
+
+// CLASS : Assembly emitter
+// - collects the generated assembly in one append-only buffer, nothing is written until write_file
+// - integers are formatted with std::to_chars, no locale or stream state is involved
+class AsmEmitter{
+private:
+    std::unique_ptr<char[]> data;
+    size_t used = 0;
+    size_t capacity = 0;
+
+    // Method to get room for n more bytes at the end of the buffer
+    char* reserve(size_t n){
+        if(used + n > capacity){
+            size_t newCapacity = capacity ? capacity * 2 : INITIAL_CAPACITY;
+            while(newCapacity < used + n){
+                newCapacity *= 2;
+            }
+            std::unique_ptr<char[]> grown(new char[newCapacity]);
+            if(used > 0){
+                std::memcpy(grown.get(), data.get(), used);
+            }
+            data = std::move(grown);
+            capacity = newCapacity;
+        }
+        return data.get() + used;
+    }
+
+public:
+    static constexpr size_t INITIAL_CAPACITY = 1 << 20;
+
+    AsmEmitter() = default;
+    AsmEmitter(const AsmEmitter&) = delete;
+    AsmEmitter& operator=(const AsmEmitter&) = delete;
+
+    AsmEmitter& operator<<(std::string_view text){
+        std::memcpy(reserve(text.size()), text.data(), text.size());
+        used += text.size();
+        return *this;
+    }
+
+    AsmEmitter& operator<<(const char* text){
+        return *this << std::string_view(text);
+    }
+
+    AsmEmitter& operator<<(const std::string& text){
+        return *this << std::string_view(text);
+    }
+
+    AsmEmitter& operator<<(char c){
+        *reserve(1) = c;
+        used++;
+        return *this;
+    }
+
+    template <typename T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, char>::value && !std::is_same<T, bool>::value, int>::type = 0>
+    AsmEmitter& operator<<(T value){
+        char* out = reserve(24);
+        used = std::to_chars(out, out + 24, value).ptr - data.get();
+        return *this;
+    }
+
+    std::string_view view() const {
+        return std::string_view(data.get(), used);
+    }
+
+    size_t size() const {
+        return used;
+    }
+
+    void clear(){
+        used = 0;
+    }
+
+    // Method to write the whole buffer to a file, returns false if it cannot be written
+    // - one write call for the whole output, looping only if the kernel takes less or a signal interrupts it
+    // - mode is the permission of a newly created file where the platform has them
+    bool write_file(const std::string& path, int mode = 0644) const {
+#ifdef ION_HAS_POSIX_IO
+        int fd;
+        do{
+            fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, mode);
+        }while(fd < 0 && errno == EINTR);
+        if(fd < 0){
+            return false;
+        }
+        size_t written = 0;
+        while(written < used){
+            ssize_t n = ::write(fd, data.get() + written, used - written);
+            if(n < 0 && errno == EINTR){
+                continue;
+            }
+            if(n < 0){
+                ::close(fd);
+                return false;
+            }
+            written += (size_t)n;
+        }
+        return ::close(fd) == 0;
+#else
+        (void)mode;
+        std::FILE* file = std::fopen(path.c_str(), "wb");
+        if(file == nullptr){
+            return false;
+        }
+        bool ok = std::fwrite(data.get(), 1, used, file) == used;
+        return std::fclose(file) == 0 && ok;
+#endif
+    }
+};
+
+#endif // EMITTER_HPP
@@ -0,0 +1,402 @@
+#ifndef ENCODER_HPP
+#define ENCODER_HPP
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "emitter.hpp"
+#include "x86.hpp"
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// SECTION : MACHINE CODE ENCODER
+// - encodes an instruction list to x86-64 machine code, no external assembler involved
+// - jumps and calls always use 32-bit displacements, so every instruction has its final size in one pass
+//-----------------------------------------------------------------------------------------------------------------------------
+
+// CLASS : X86 encoder
+class X86Encoder{
+public:
+    std::vector<uint8_t> text;
+    std::vector<int64_t> labelOffsets;      // code label -> offset in text, -1 until placed
+
+    // Method to encode the whole list, label addresses are filled in later by link
+    void encode(const InstrList& list){
+        text.clear();
+        fixups.clear();
+        labelOffsets.assign(list.labels.size(), -1);
+        for(const Instr& instr : list.code){
+            encode(instr);
+        }
+    }
+
+    // Method to patch label references once the addresses of both segments are known
+    void link(const InstrList& list, uint64_t textAddress, uint64_t dataAddress){
+        for(const Fixup& fixup : fixups){
+            const InstrList::Label& label = list.labels[fixup.label];
+            if(!label.data && labelOffsets[fixup.label] < 0){
+                throw std::runtime_error("Label never placed: " + label.name);
+            }
+
+            if(fixup.relative){
+                if(label.data){
+                    throw std::runtime_error("Jump to a data label: " + label.name);
+                }
+                put(fixup.at, (uint64_t)(labelOffsets[fixup.label] - (int64_t)(fixup.at + 4)), 4);
+            }else{
+                uint64_t address = label.data ? dataAddress + label.offset : textAddress + labelOffsets[fixup.label];
+                put(fixup.at, address, 8);
+            }
+        }
+    }
+
+private:
+    struct Fixup{
+        uint32_t at;        // offset of the field in text
+        uint32_t label;
+        bool relative;      // rel32 from the end of the field, or an absolute 64-bit address
+    };
+    std::vector<Fixup> fixups;
+
+    static int low(Reg reg){ return (int)reg & 7; }
+    static bool high(Reg reg){ return reg != Reg::NONE && (int)reg >= 8; }
+
+    void byte(uint8_t b){
+        text.push_back(b);
+    }
+
+    void value(uint64_t v, int bytes){
+        for(int i = 0; i < bytes; i++){
+            text.push_back((uint8_t)(v >> (8 * i)));
+        }
+    }
+
+    void put(uint32_t at, uint64_t v, int bytes){
+        for(int i = 0; i < bytes; i++){
+            text[at + i] = (uint8_t)(v >> (8 * i));
+        }
+    }
+
+    void reference(uint32_t label, bool relative){
+        fixups.push_back(Fixup{(uint32_t)text.size(), label, relative});
+        value(0, relative ? 4 : 8);
+    }
+
+    static bool fits_int8(int64_t v){ return v >= -128 && v <= 127; }
+    static bool fits_int32(int64_t v){ return v >= INT32_MIN && v <= INT32_MAX; }
+
+    // an immediate for an operand of size bytes, 8-byte operands only take a sign-extended 32-bit immediate
+    static bool fits_immediate(int64_t v, int size){
+        if(size == 1) return v >= INT8_MIN && v <= UINT8_MAX;
+        if(size == 4) return v >= INT32_MIN && v <= UINT32_MAX;
+        return fits_int32(v);
+    }
+
+    // 16-bit operands would need a 0x66 prefix, which nothing emits
+    static bool is_word(const Operand& o){
+        return (o.is(Operand::Kind::REG) || o.is(Operand::Kind::MEM)) && o.size == 2;
+    }
+
+    // spl, bpl, sil and dil only exist with a REX prefix
+    static bool needs_byte_rex(const Operand& o){
+        return o.is(Operand::Kind::REG) && o.size == 1 && (int)o.reg >= 4 && (int)o.reg <= 7;
+    }
+
+    // FUNCTION : rm form
+    // - prefix, opcode and ModRM for "opcode r/m, reg", field is a register or an opcode extension
+    void rm_form(std::initializer_list<uint8_t> opcode, bool wide, Reg field, int extension, const Operand& rm, bool byteRex = false){
+        uint8_t rex = 0x40 | (wide ? 8 : 0) | (high(field) ? 4 : 0) | (high(rm.reg) ? 1 : 0);
+        if(rex != 0x40 || byteRex){
+            byte(rex);
+        }
+        for(uint8_t b : opcode){
+            byte(b);
+        }
+
+        int reg = field != Reg::NONE ? low(field) : extension;
+        if(rm.is(Operand::Kind::REG)){
+            byte(0xC0 | reg << 3 | low(rm.reg));
+            return;
+        }
+
+        // [base + displacement], rbp and r13 need a displacement, rsp and r12 need a SIB byte
+        int base = low(rm.reg);
+        int mod = rm.value == 0 && base != 5 ? 0 : fits_int8(rm.value) ? 1 : 2;
+        byte(mod << 6 | reg << 3 | base);
+        if(base == 4){
+            byte(0x24);
+        }
+        if(mod == 1) value((uint64_t)rm.value, 1);
+        if(mod == 2) value((uint64_t)rm.value, 4);
+    }
+
+    // FUNCTION : arithmetic
+    // - add, sub, and, xor, cmp and test in their register, memory and immediate forms
+    void arithmetic(uint8_t opcode, int extension, const Operand& a, const Operand& b){
+        bool wide = a.size == 8;
+        bool narrow = a.size == 1;
+        if(b.is(Operand::Kind::REG)){
+            rm_form({(uint8_t)(narrow ? opcode - 1 : opcode)}, wide, b.reg, 0, a, needs_byte_rex(a) || needs_byte_rex(b));
+        }else if(a.is(Operand::Kind::REG) && b.is(Operand::Kind::MEM) && opcode != 0x85){
+            // "op reg, r/m" is two above "op r/m, reg"
+            rm_form({(uint8_t)(narrow ? opcode + 1 : opcode + 2)}, wide, a.reg, 0, b, needs_byte_rex(a));
+        }else if(b.is(Operand::Kind::IMM)){
+            if(!fits_immediate(b.value, a.size)){
+                unsupported(a, b);
+            }
+            // a 32-bit operation only sees the low 32 bits, 0xFFFFFFFF is -1 and fits in a byte
+            int64_t imm = a.size == 4 ? (int32_t)(uint32_t)b.value : b.value;
+            if(narrow){
+                rm_form({0x80}, false, Reg::NONE, extension, a, needs_byte_rex(a));
+                value((uint64_t)imm, 1);
+            }else if(fits_int8(imm)){
+                rm_form({0x83}, wide, Reg::NONE, extension, a);
+                value((uint64_t)imm, 1);
+            }else{
+                rm_form({0x81}, wide, Reg::NONE, extension, a);
+                value((uint64_t)imm, 4);
+            }
+        }else{
+            unsupported(a, b);
+        }
+    }
+
+    // FUNCTION : shift
+    // - by an immediate, a shift by 1 has a shorter form without it
+    void shift(int extension, const Operand& a, const Operand& b){
+        if(!b.is(Operand::Kind::IMM)){
+            unsupported(a, b);
+        }
+        bool narrow = a.size == 1;
+        if(b.value == 1){
+            rm_form({(uint8_t)(narrow ? 0xD0 : 0xD1)}, a.size == 8, Reg::NONE, extension, a, needs_byte_rex(a));
+        }else{
+            rm_form({(uint8_t)(narrow ? 0xC0 : 0xC1)}, a.size == 8, Reg::NONE, extension, a, needs_byte_rex(a));
+            value((uint64_t)b.value, 1);
+        }
+    }
+
+    void mov(const Operand& a, const Operand& b){
+        bool wide = a.size == 8;
+        if(a.is(Operand::Kind::REG) && b.is(Operand::Kind::LABEL)){
+            // movabs, the address is patched in by link
+            byte(0x48 | (high(a.reg) ? 1 : 0));
+            byte(0xB8 + low(a.reg));
+            reference(b.label, false);
+        }else if(a.is(Operand::Kind::REG) && b.is(Operand::Kind::IMM)){
+            if(wide && fits_int32(b.value)){
+                rm_form({0xC7}, true, Reg::NONE, 0, a);
+                value((uint64_t)b.value, 4);
+            }else{
+                // the only form with a full 64-bit immediate
+                if(!wide && !fits_immediate(b.value, a.size)){
+                    unsupported(a, b);
+                }
+                if(wide || high(a.reg) || needs_byte_rex(a)){
+                    byte(0x40 | (wide ? 8 : 0) | (high(a.reg) ? 1 : 0));
+                }
+                byte((a.size == 1 ? 0xB0 : 0xB8) + low(a.reg));
+                value((uint64_t)b.value, a.size);
+            }
+        }else if(a.is(Operand::Kind::MEM) && b.is(Operand::Kind::IMM)){
+            if(!fits_immediate(b.value, a.size)){
+                unsupported(a, b);
+            }
+            rm_form({(uint8_t)(a.size == 1 ? 0xC6 : 0xC7)}, wide, Reg::NONE, 0, a);
+            value((uint64_t)b.value, a.size == 1 ? 1 : 4);
+        }else if(b.is(Operand::Kind::REG)){
+            // register or memory destination
+            rm_form({(uint8_t)(b.size == 1 ? 0x88 : 0x89)}, b.size == 8, b.reg, 0, a, needs_byte_rex(a) || needs_byte_rex(b));
+        }else if(a.is(Operand::Kind::REG) && b.is(Operand::Kind::MEM)){
+            rm_form({(uint8_t)(a.size == 1 ? 0x8A : 0x8B)}, wide, a.reg, 0, b, needs_byte_rex(a));
+        }else{
+            unsupported(a, b);
+        }
+    }
+
+    void jump(std::initializer_list<uint8_t> opcode, const Operand& target){
+        for(uint8_t b : opcode){
+            byte(b);
+        }
+        reference(target.label, true);
+    }
+
+    [[noreturn]] static void unsupported(const Operand& a, const Operand& b){
+        throw std::runtime_error("Unsupported operand combination: " + std::to_string((int)a.kind) + ", " + std::to_string((int)b.kind));
+    }
+
+    void encode(const Instr& instr){
+        const Operand& a = instr.a;
+        const Operand& b = instr.b;
+        if(is_word(a) || is_word(b)){
+            unsupported(a, b);
+        }
+        switch(instr.op){
+            case Op::LABEL:
+                labelOffsets[a.label] = (int64_t)text.size();
+                break;
+            case Op::MOV:
+                mov(a, b);
+                break;
+            case Op::MOVSX:
+                rm_form({0x0F, 0xBE}, a.size == 8, a.reg, 0, b, needs_byte_rex(b));
+                break;
+            case Op::MOVSXD:
+                rm_form({0x63}, true, a.reg, 0, b);
+                break;
+            case Op::MOVZX:
+                rm_form({0x0F, 0xB6}, a.size == 8, a.reg, 0, b, needs_byte_rex(b));
+                break;
+            case Op::LEA:
+                rm_form({0x8D}, true, a.reg, 0, b);
+                break;
+            case Op::ADD: arithmetic(0x01, 0, a, b); break;
+            case Op::SUB: arithmetic(0x29, 5, a, b); break;
+            case Op::AND: arithmetic(0x21, 4, a, b); break;
+            case Op::XOR: arithmetic(0x31, 6, a, b); break;
+            case Op::CMP: arithmetic(0x39, 7, a, b); break;
+            case Op::TEST:
+                if(!b.is(Operand::Kind::REG)) unsupported(a, b);
+                arithmetic(0x85, 0, a, b);
+                break;
+            case Op::IMUL:
+                rm_form({0x0F, 0xAF}, a.size == 8, a.reg, 0, b);
+                break;
+            case Op::IMUL_IMM:
+                if(!fits_immediate(instr.immediate, a.size)){
+                    unsupported(a, b);
+                }
+                if(fits_int8(instr.immediate)){
+                    rm_form({0x6B}, a.size == 8, a.reg, 0, b);
+                    value((uint64_t)instr.immediate, 1);
+                }else{
+                    rm_form({0x69}, a.size == 8, a.reg, 0, b);
+                    value((uint64_t)instr.immediate, 4);
+                }
+                break;
+            case Op::IDIV: rm_form({0xF7}, a.size == 8, Reg::NONE, 7, a); break;
+            case Op::DIV: rm_form({0xF7}, a.size == 8, Reg::NONE, 6, a); break;
+            case Op::NEG: rm_form({0xF7}, a.size == 8, Reg::NONE, 3, a); break;
+            case Op::INC: rm_form({0xFF}, a.size == 8, Reg::NONE, 0, a); break;
+            case Op::DEC: rm_form({0xFF}, a.size == 8, Reg::NONE, 1, a); break;
+            case Op::SHL: shift(4, a, b); break;
+            case Op::SHR: shift(5, a, b); break;
+            case Op::SAR: shift(7, a, b); break;
+            case Op::SETE: rm_form({0x0F, 0x94}, false, Reg::NONE, 0, a, needs_byte_rex(a)); break;
+            case Op::SETNE: rm_form({0x0F, 0x95}, false, Reg::NONE, 0, a, needs_byte_rex(a)); break;
+            case Op::SETL: rm_form({0x0F, 0x9C}, false, Reg::NONE, 0, a, needs_byte_rex(a)); break;
+            case Op::SETGE: rm_form({0x0F, 0x9D}, false, Reg::NONE, 0, a, needs_byte_rex(a)); break;
+            case Op::SETLE: rm_form({0x0F, 0x9E}, false, Reg::NONE, 0, a, needs_byte_rex(a)); break;
+            case Op::SETG: rm_form({0x0F, 0x9F}, false, Reg::NONE, 0, a, needs_byte_rex(a)); break;
+            case Op::CDQ:
+                byte(0x99);
+                break;
+            case Op::CQO:
+                byte(0x48);
+                byte(0x99);
+                break;
+            case Op::PUSH:
+            case Op::POP:
+                if(high(a.reg)) byte(0x41);
+                byte((instr.op == Op::PUSH ? 0x50 : 0x58) + low(a.reg));
+                break;
+            case Op::CALL: jump({0xE8}, a); break;
+            case Op::JMP: jump({0xE9}, a); break;
+            case Op::JE: jump({0x0F, 0x84}, a); break;
+            case Op::JNZ: jump({0x0F, 0x85}, a); break;
+            case Op::JNS: jump({0x0F, 0x89}, a); break;
+            case Op::JL: jump({0x0F, 0x8C}, a); break;
+            case Op::JGE: jump({0x0F, 0x8D}, a); break;
+            case Op::JLE: jump({0x0F, 0x8E}, a); break;
+            case Op::JG: jump({0x0F, 0x8F}, a); break;
+            case Op::RET:
+                byte(0xC3);
+                break;
+            case Op::SYSCALL:
+                byte(0x0F);
+                byte(0x05);
+                break;
+        }
+    }
+};
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// SECTION : ELF64 EXECUTABLE
+// - a static executable with no sections, one read+execute segment holding the headers and the code
+//   and one read+write segment holding the data
+//-----------------------------------------------------------------------------------------------------------------------------
+
+const uint64_t ELF64_BASE_ADDRESS = 0x400000;
+const uint64_t ELF64_PAGE_SIZE = 0x1000;
+
+void put_le(std::string& out, uint64_t v, int bytes){
+    for(int i = 0; i < bytes; i++){
+        out.push_back((char)(v >> (8 * i)));
+    }
+}
+
+void put_program_header(std::string& out, uint32_t flags, uint64_t offset, uint64_t address, uint64_t size){
+    put_le(out, 1, 4);                  // PT_LOAD
+    put_le(out, flags, 4);
+    put_le(out, offset, 8);
+    put_le(out, address, 8);            // virtual address
+    put_le(out, address, 8);            // physical address
+    put_le(out, size, 8);               // size in the file
+    put_le(out, size, 8);               // size in memory
+    put_le(out, ELF64_PAGE_SIZE, 8);
+}
+
+// FUNCTION : write elf64 executable
+// - encodes the list, lays out both segments, links the code and writes a runnable file, returns false if it cannot be written
+bool write_elf64_executable(const InstrList& list, uint32_t entry, const std::string& path){
+    const uint64_t headersSize = 64 + 2 * 56;
+
+    X86Encoder encoder;
+    encoder.encode(list);
+
+    // the data segment goes on a page of its own, at an address congruent to its file offset
+    uint64_t textAddress = ELF64_BASE_ADDRESS + headersSize;
+    uint64_t dataOffset = (headersSize + encoder.text.size() + 15) & ~(uint64_t)15;
+    uint64_t dataAddress = ((ELF64_BASE_ADDRESS + dataOffset + ELF64_PAGE_SIZE - 1) & ~(ELF64_PAGE_SIZE - 1)) + (dataOffset & (ELF64_PAGE_SIZE - 1));
+    encoder.link(list, textAddress, dataAddress);
+    if(encoder.labelOffsets[entry] < 0){
+        throw std::runtime_error("Entry point never placed");
+    }
+
+    std::string file;
+    file.reserve(dataOffset + list.data.size());
+
+    // ELF header
+    file.append("\x7F" "ELF", 4);
+    file.push_back(2);                  // 64-bit
+    file.push_back(1);                  // little endian
+    file.push_back(1);                  // ELF version
+    file.append(9, '\0');               // System V ABI and padding
+    put_le(file, 2, 2);                 // ET_EXEC
+    put_le(file, 0x3E, 2);              // x86-64
+    put_le(file, 1, 4);
+    put_le(file, textAddress + encoder.labelOffsets[entry], 8);
+    put_le(file, 64, 8);                // program headers follow the ELF header
+    put_le(file, 0, 8);                 // no section headers
+    put_le(file, 0, 4);
+    put_le(file, 64, 2);
+    put_le(file, 56, 2);
+    put_le(file, 2, 2);
+    put_le(file, 64, 2);
+    put_le(file, 0, 2);
+    put_le(file, 0, 2);
+
+    put_program_header(file, 5, 0, ELF64_BASE_ADDRESS, headersSize + encoder.text.size());   // read + execute
+    put_program_header(file, 6, dataOffset, dataAddress, list.data.size());                  // read + write
+
+    file.append((const char*)encoder.text.data(), encoder.text.size());
+    file.resize(dataOffset, '\0');
+    file.append(list.data);
+
+    AsmEmitter out;
+    out << std::string_view(file);
+    return out.write_file(path, 0755);
+}
+
+#endif // ENCODER_HPP
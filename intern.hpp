@@ -0,0 +1,97 @@
+#ifndef INTERN_HPP
+#define INTERN_HPP
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "arena.hpp"
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// SECTION : STRING INTERNING
+//-----------------------------------------------------------------------------------------------------------------------------
+
+// SYMBOL ID
+// - dense 32-bit handle for an interned identifier or string literal
+using symbol_id = uint32_t;
+
+// CLASS : Interner
+// - maps every distinct text to one symbol ID, so later passes compare and hash integers
+// - open addressing with linear probing, the table is kept at most half full
+class Interner{
+private:
+    static constexpr uint32_t EMPTY = 0xFFFFFFFF;
+
+    Arena storage;
+    std::vector<std::string_view> texts;    // symbol ID -> text
+    std::vector<uint64_t> hashes;           // symbol ID -> hash, kept for rehashing
+    std::vector<symbol_id> slots;           // hash slot -> symbol ID
+
+    static uint64_t hash(std::string_view text){
+        // FNV-1a
+        uint64_t h = 14695981039346656037ull;
+        for(char c : text){
+            h ^= (unsigned char)c;
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+
+    void rehash(size_t capacity){
+        slots.assign(capacity, EMPTY);
+        for(symbol_id id = 0; id < texts.size(); id++){
+            size_t slot = hashes[id] & (capacity - 1);
+            while(slots[slot] != EMPTY){
+                slot = (slot + 1) & (capacity - 1);
+            }
+            slots[slot] = id;
+        }
+    }
+
+public:
+    Interner(){
+        slots.assign(1024, EMPTY);
+    }
+
+    Interner(const Interner&) = delete;
+    Interner& operator=(const Interner&) = delete;
+
+    // Method to get the symbol ID of a text, adding it if it is new
+    symbol_id intern(std::string_view text){
+        uint64_t h = hash(text);
+        size_t mask = slots.size() - 1;
+        size_t slot = h & mask;
+        while(slots[slot] != EMPTY){
+            symbol_id id = slots[slot];
+            if(hashes[id] == h && texts[id] == text){
+                return id;
+            }
+            slot = (slot + 1) & mask;
+        }
+
+        symbol_id id = (symbol_id)texts.size();
+        texts.push_back(storage.copy(text));
+        hashes.push_back(h);
+        slots[slot] = id;
+
+        if(texts.size() * 2 > slots.size()){
+            rehash(slots.size() * 2);
+        }
+        return id;
+    }
+
+    // Method to get the text of a symbol ID
+    std::string_view name(symbol_id id) const {
+        return texts[id];
+    }
+
+    size_t size() const {
+        return texts.size();
+    }
+};
+
+// CURRENT INTERNER
+// - owned by the compilation context running on this thread
+thread_local Interner* SYMBOLS = nullptr;
+
+#endif // INTERN_HPP
@@ -0,0 +1,198 @@
+#ifndef INTERPRETER_HPP
+#define INTERPRETER_HPP
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "bytecode.hpp"
+
+// threaded dispatch jumps straight from one handler to the next through a table of label addresses
+#if defined(__GNUC__)
+#define ION_HAS_COMPUTED_GOTO 1
+#endif
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// SECTION : INTERPRETER
+// - frames are windows of one register stack, a call's frame starts right after its caller's
+// - the stack is left uninitialized, so pages nothing reaches are never touched, only the frame of main starts at 0
+// - integers wrap at 32 bits, like the stack slots of the native code
+// - output is buffered and written when the buffer fills up and when the program ends
+//-----------------------------------------------------------------------------------------------------------------------------
+
+// CLASS : Interpreter
+class Interpreter{
+public:
+    explicit Interpreter(const BytecodeProgram& program, size_t stackRegisters = 1 << 20)
+        : program(program), stack(new int64_t[stackRegisters]), stackSize(stackRegisters) {}
+
+    // Method to run the program from the top level until it returns
+    void run(){
+        try {
+            execute();
+        } catch (...) {
+            flush();
+            throw;
+        }
+        flush();
+    }
+
+private:
+    struct Frame{
+        const Instruction* returnTo;
+        int64_t* registers;
+        uint32_t function;
+        uint16_t result;
+    };
+
+    const BytecodeProgram& program;
+    std::unique_ptr<int64_t[]> stack;
+    size_t stackSize;
+    std::vector<Frame> frames;
+    std::string output;
+
+    void flush(){
+        if(!output.empty()){
+            std::fwrite(output.data(), 1, output.size(), stdout);
+            std::fflush(stdout);
+            output.clear();
+        }
+    }
+
+    void write_int(int64_t value){
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        output.append(digits, result.ptr - digits);
+        if(output.size() >= (1 << 16)) flush();
+    }
+
+    void write_text(const char* text, size_t length){
+        output.append(text, length);
+        if(output.size() >= (1 << 16)) flush();
+    }
+
+    static int64_t wrap(int64_t value){
+        return (int32_t)(uint32_t)(uint64_t)value;
+    }
+
+    void execute(){
+        const Instruction* code = program.code.data();
+        const int64_t* constants = program.constants.data();
+        int64_t* R = stack.get();
+        int64_t* stackEnd = stack.get() + stackSize;
+        uint32_t function = 0;
+        if(program.functions[0].registers > stackSize){
+            throw std::runtime_error("Stack overflow");
+        }
+        std::fill(R, R + program.functions[0].registers, 0);
+
+        const Instruction* pc = code + program.functions[0].entry;
+        const Instruction* in;
+
+#ifdef ION_HAS_COMPUTED_GOTO
+        static void* const handlers[] = {
+#define ION_OPCODE_LABEL(name) &&op_##name,
+            ION_OPCODES(ION_OPCODE_LABEL)
+#undef ION_OPCODE_LABEL
+        };
+#define OP(name) op_##name:
+#define NEXT() do { in = pc++; goto *handlers[(int)in->op]; } while(0)
+        NEXT();
+#else
+#define OP(name) case Opcode::name:
+#define NEXT() continue
+        for(;;){
+            in = pc++;
+            switch(in->op){
+#endif
+
+        OP(LOADI) R[in->a] = in->k(); NEXT();
+        OP(LOADK) R[in->a] = constants[in->k()]; NEXT();
+        OP(MOVE) R[in->a] = R[in->b]; NEXT();
+        OP(GETG) R[in->a] = stack[in->k()]; NEXT();
+        OP(SETG) stack[in->k()] = R[in->a]; NEXT();
+        OP(ADD) R[in->a] = wrap(R[in->b] + R[in->c]); NEXT();
+        OP(ADDI) R[in->a] = wrap(R[in->b] + (int16_t)in->c); NEXT();
+        OP(SUB) R[in->a] = wrap(R[in->b] - R[in->c]); NEXT();
+        OP(MUL) R[in->a] = wrap((int64_t)((uint64_t)R[in->b] * (uint64_t)R[in->c])); NEXT();
+        OP(DIV)
+            if(R[in->c] == 0) throw std::runtime_error("Division by zero");
+            R[in->a] = wrap(R[in->b] / R[in->c]);
+            NEXT();
+        OP(MOD)
+            if(R[in->c] == 0) throw std::runtime_error("Division by zero");
+            R[in->a] = wrap(R[in->b] % R[in->c]);
+            NEXT();
+        OP(NEG) R[in->a] = wrap(-R[in->b]); NEXT();
+        OP(NOT) R[in->a] = !R[in->b]; NEXT();
+        OP(EQ) R[in->a] = R[in->b] == R[in->c]; NEXT();
+        OP(NE) R[in->a] = R[in->b] != R[in->c]; NEXT();
+        OP(LT) R[in->a] = R[in->b] < R[in->c]; NEXT();
+        OP(LE) R[in->a] = R[in->b] <= R[in->c]; NEXT();
+        OP(GT) R[in->a] = R[in->b] > R[in->c]; NEXT();
+        OP(GE) R[in->a] = R[in->b] >= R[in->c]; NEXT();
+        OP(JMP) pc += in->k(); NEXT();
+        OP(JMPF) if(R[in->a] == 0) pc += in->k(); NEXT();
+        OP(JMPT) if(R[in->a] != 0) pc += in->k(); NEXT();
+
+        // the JMP after a compare is taken in place, without dispatching on it
+#define ION_COMPARE_JUMP(name, cmp) \
+        OP(name) \
+            if(R[in->a] cmp R[in->b]) pc += 1 + pc->k(); \
+            else pc++; \
+            NEXT();
+        ION_COMPARE_JUMP(JEQ, ==)
+        ION_COMPARE_JUMP(JNE, !=)
+        ION_COMPARE_JUMP(JLT, <)
+        ION_COMPARE_JUMP(JLE, <=)
+        ION_COMPARE_JUMP(JGT, >)
+        ION_COMPARE_JUMP(JGE, >=)
+#undef ION_COMPARE_JUMP
+
+        OP(CALL) {
+            const BytecodeFunction& callee = program.functions[in->b];
+            int64_t* frame = R + program.functions[function].registers;
+            if(frame + callee.registers > stackEnd){
+                throw std::runtime_error("Stack overflow");
+            }
+            std::memmove(frame, R + in->c, callee.parameters * sizeof(int64_t));
+            frames.push_back(Frame{pc, R, function, in->a});
+            R = frame;
+            function = in->b;
+            pc = code + callee.entry;
+            NEXT();
+        }
+        OP(RET) {
+            if(frames.empty()){
+                return;
+            }
+            int64_t value = R[in->a];
+            const Frame& caller = frames.back();
+            pc = caller.returnTo;
+            R = caller.registers;
+            function = caller.function;
+            R[caller.result] = value;
+            frames.pop_back();
+            NEXT();
+        }
+        OP(WRITE_INT) write_int(R[in->a]); NEXT();
+        OP(WRITE_CHAR) { char c = (char)R[in->a]; write_text(&c, 1); NEXT(); }
+        OP(WRITE_BOOL) if(R[in->a]) write_text("TRUE", 4); else write_text("FALSE", 5); NEXT();
+        OP(WRITE_STR) { const char* text = (const char*)(intptr_t)R[in->a]; write_text(text, std::strlen(text)); NEXT(); }
+
+#ifndef ION_HAS_COMPUTED_GOTO
+            }
+        }
+#endif
+#undef OP
+#undef NEXT
+    }
+};
+
+#endif // INTERPRETER_HPP
@@ -1,36 +1,206 @@
 #include <string>
+#include <sstream>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <exception>
 #include <fstream>
 #include "compiler.hpp"
+#include "source.hpp"
+
+// FUNCTION : is ion file
+// - every extension in the name must be .ion
+bool is_ion_file(const char* path){
+    bool is_ion = false;
+    for(int j = 0; path[j] != '\0'; ++j) {
+        if (path[j] == '.') {
+            if (path[j + 1] != 'i' || path[j + 2] != 'o' || path[j + 3] != 'n') {
+                return false;
+            }
+            is_ion = true;
+        }
+    }
+    return is_ion;
+}
+
+// FUNCTION : compile file
+// - loads and compiles one file, returns false if it failed
+// - a failure is reported on err and does not stop the other files
+// - the time report covers loading the file and every phase that ran, even when a later one failed
+bool compile_file(const char* path, const DumpOptions& dumps, Target target, Emit emit, int optimize, TimeReport::Format timeFormat, std::ostream& out, std::ostream& err){
+    TimeReport report(timeFormat);
+    report.begin("load");
+    SourceFile source;
+    if (!source.open(path)) {
+        err << "ERR: File not found: " << path << "\n";
+        return false;
+    }
+    report.end(source.size(), "bytes");
+
+    bool ok = true;
+    try {
+        compile(path, source.view(), dumps, target, emit, optimize, out, report);
+    } catch (const std::exception& e) {
+        err << "ERR: " << path << ": " << e.what() << "\n";
+        ok = false;
+    }
+    report.print(out, path);
+    return ok;
+}
+
+// Output of one file compiled on a worker thread, printed in command line order
+struct FileResult{
+    std::ostringstream out;
+    std::ostringstream err;
+    bool ok = false;
+};
 
 int main(int argc, char *argv[]){
-    for (int i = 1; i < argc; ++i) {
-        bool is_ion = false;
-        for(int j = 0; argv[i][j] != '\0'; ++j) {
-            if (argv[i][j] == '.') {
-                if (argv[i][j + 1] != 'i' || argv[i][j + 2] != 'o' || argv[i][j + 3] != 'n') {
-                    std::cerr << "ERR: File format not recognized\n";
-                    return 1;
-                }
-                is_ion = true;
+    int jobs = 1;
+    std::vector<const char*> files;
+    DumpOptions dumps;
+    const char* dumpPath = nullptr;
+    TimeReport::Format timeFormat = TimeReport::Format::NONE;
+    Target target = Target::PE64;
+    Emit emit = Emit::ASM;
+    int optimize = 1;
+
+    // "ion run" compiles in memory and runs each program in this process, one at a time
+    // - natively through the JIT, or with --interp through the bytecode interpreter
+    bool run = argc > 1 && std::string(argv[1]) == "run";
+    bool interpret = false;
+
+    for (int i = run ? 2 : 1; i < argc; ++i) {
+        std::string arg(argv[i]);
+        if (arg == "--dump-tokens") {
+            dumps.tokens = true;
+            continue;
+        } else if (arg == "--dump-ast") {
+            dumps.ast = true;
+            continue;
+        } else if (arg == "--dump-symbols") {
+            dumps.symbols = true;
+            continue;
+        } else if (arg == "--dump-bytecode") {
+            dumps.bytecode = true;
+            continue;
+        } else if (arg == "--dump-ir") {
+            dumps.ir = true;
+            continue;
+        } else if (run && arg == "--interp") {
+            interpret = true;
+            continue;
+        } else if (arg == "--time-report" || arg == "--time-report=text") {
+            timeFormat = TimeReport::Format::TEXT;
+            continue;
+        } else if (arg == "--time-report=json") {
+            timeFormat = TimeReport::Format::JSON;
+            continue;
+        } else if (arg == "--target") {
+            std::string name = i + 1 < argc ? argv[++i] : "";
+            if (name == "pe64") {
+                target = Target::PE64;
+            } else if (name == "elf64") {
+                target = Target::ELF64;
+            } else {
+                std::cerr << "ERR: --target expects pe64 or elf64\n";
+                return 1;
+            }
+            continue;
+        } else if (arg == "--emit") {
+            std::string name = i + 1 < argc ? argv[++i] : "";
+            if (name == "asm") {
+                emit = Emit::ASM;
+            } else if (name == "exe") {
+                emit = Emit::EXE;
+            } else {
+                std::cerr << "ERR: --emit expects asm or exe\n";
+                return 1;
             }
+            continue;
+        } else if (arg == "-O0" || arg == "-O1") {
+            optimize = arg[2] - '0';
+            continue;
+        } else if (arg == "--dump-file") {
+            if (i + 1 >= argc) {
+                std::cerr << "ERR: --dump-file expects a path\n";
+                return 1;
+            }
+            dumpPath = argv[++i];
+            continue;
+        } else if (arg.compare(0, 2, "-j") == 0) {
+            std::string count = arg.size() > 2 ? arg.substr(2) : (i + 1 < argc ? argv[++i] : "");
+            jobs = std::atoi(count.c_str());
+            if (jobs < 1) {
+                std::cerr << "ERR: -j expects a positive number of jobs\n";
+                return 1;
+            }
+            continue;
         }
-        if(!is_ion) {
+
+        if (!is_ion_file(argv[i])) {
+            std::cerr << "ERR: File format not recognized\n";
             return 1;
         }
+        files.push_back(argv[i]);
+    }
+
+    if (run) {
+        target = Target::ELF64;
+        emit = interpret ? Emit::INTERP : Emit::JIT;
+        jobs = 1;
+    }
+    if (emit == Emit::EXE && target != Target::ELF64) {
+        std::cerr << "ERR: --emit exe needs --target elf64\n";
+        return 1;
+    }
 
-        std::ifstream file(argv[i]);
-        if (!file.is_open()) {
-            std::cerr << "ERR: File not found\n";
+    // Dumps are written through a large buffer, to the dump file if one was given
+    std::ios::sync_with_stdio(false);
+    static char dumpBuffer[1 << 16];
+    std::ofstream dumpFile;
+    std::ostream* dumpOut = &std::cout;
+    if (dumpPath != nullptr) {
+        dumpFile.rdbuf()->pubsetbuf(dumpBuffer, sizeof(dumpBuffer));
+        dumpFile.open(dumpPath);
+        if (!dumpFile) {
+            std::cerr << "ERR: Cannot open dump file: " << dumpPath << "\n";
             return 1;
         }
+        dumpOut = &dumpFile;
+    }
 
-        std::string program, line;
-        while (std::getline(file, line)) {
-            program += line + '\n';
+    bool ok = true;
+    if (jobs == 1 || files.size() <= 1) {
+        for (const char* file : files) {
+            ok &= compile_file(file, dumps, target, emit, optimize, timeFormat, *dumpOut, std::cerr);
         }
+        dumpOut->flush();
+        return ok ? 0 : 1;
+    }
+
+    // Files are independent, each worker takes the next one until none are left
+    std::vector<FileResult> results(files.size());
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> workers;
+    size_t workerCount = std::min(files.size(), (size_t)jobs);
+    for (size_t w = 0; w < workerCount; ++w) {
+        workers.emplace_back([&]() {
+            for (size_t i = next++; i < files.size(); i = next++) {
+                results[i].ok = compile_file(files[i], dumps, target, emit, optimize, timeFormat, results[i].out, results[i].err);
+            }
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
 
-        compile(argv[i], program);
+    for (FileResult& result : results) {
+        *dumpOut << result.out.str();
+        std::cerr << result.err.str();
+        ok &= result.ok;
     }
+    dumpOut->flush();
 
-    return 0;
+    return ok ? 0 : 1;
 }
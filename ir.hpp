@@ -0,0 +1,595 @@
+#ifndef IR_HPP
+#define IR_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ast.hpp"
+#include "table.hpp"
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// SECTION : INTERMEDIATE REPRESENTATION
+// - three-address code between the AST and the native code, every instruction reads at most two operands and
+//   defines at most one value
+// - values are numbered virtual registers, %n, they hold temporaries only: variables live in the stack slots the
+//   resolver assigned them and are read and written by explicit loads and stores
+// - a value is defined once, except the result of && and || used as a value, which each branch copies into
+// - the code is a list of basic blocks in layout order, each ending in a jump, a branch or the return of the program
+// - instructions are typed with the language's types, so a backend knows the width of every value
+//-----------------------------------------------------------------------------------------------------------------------------
+
+// OPERATIONS
+// - T is the type of the instruction, the type of its operands, a comparison defines a bool
+#define ION_IR_OPS(X) \
+    X(LOAD,  "load")    /* %d = load T [slot]                               */ \
+    X(STORE, "store")   /* store T [slot], a                                */ \
+    X(COPY,  "copy")    /* %d = copy T a                                    */ \
+    X(ADD,   "add")     /* %d = add T a, b                                  */ \
+    X(SUB,   "sub")     /* %d = sub T a, b                                  */ \
+    X(MUL,   "mul")     /* %d = mul T a, b                                  */ \
+    X(DIV,   "div")     /* %d = div T a, b, rounds toward zero              */ \
+    X(MOD,   "mod")     /* %d = mod T a, b, has the sign of a               */ \
+    X(NEG,   "neg")     /* %d = neg T a                                     */ \
+    X(NOT,   "not")     /* %d = not T a                                     */ \
+    X(EQ,    "eq")      /* %d = eq T a, b                                   */ \
+    X(NE,    "ne")      /* %d = ne T a, b                                   */ \
+    X(LT,    "lt")      /* %d = lt T a, b                                   */ \
+    X(LE,    "le")      /* %d = le T a, b                                   */ \
+    X(GT,    "gt")      /* %d = gt T a, b                                   */ \
+    X(GE,    "ge")      /* %d = ge T a, b                                   */ \
+    X(WRITE, "write")   /* write T a                                        */ \
+    X(JMP,   "jmp")     /* jmp target                                       */ \
+    X(BR,    "br")      /* br T a, target, otherwise: target if a is not 0  */ \
+    X(RET,   "ret")     /* end of the program                               */
+
+enum class IrOp : uint8_t {
+#define ION_IR_ENUM(name, text) name,
+    ION_IR_OPS(ION_IR_ENUM)
+#undef ION_IR_ENUM
+};
+
+const char* ir_op_name(IrOp op){
+    static const char* const names[] = {
+#define ION_IR_NAME(name, text) text,
+        ION_IR_OPS(ION_IR_NAME)
+#undef ION_IR_NAME
+    };
+    return names[(int)op];
+}
+
+const char* ir_type_name(data_type type){
+    switch(type){
+        case data_type::INTEGER: return "int";
+        case data_type::CHAR: return "char";
+        case data_type::BOOLEAN: return "bool";
+        case data_type::STRING: return "str";
+        case data_type::FLOAT: return "float";
+        default: return "?";
+    }
+}
+
+// Bytes a value of a type takes in its stack slot
+int ir_type_size(data_type type){
+    switch(type){
+        case data_type::INTEGER: return 4;
+        case data_type::CHAR:
+        case data_type::BOOLEAN: return 1;
+        default: return 8;
+    }
+}
+
+// OPERAND
+// - a value, a constant, a stack slot or the address of a string literal
+struct IrOperand{
+    enum class Kind : uint8_t { NONE, VALUE, CONST, SLOT, STRING };
+
+    Kind kind = Kind::NONE;
+    symbol_id name = 0;     // variable of a slot, for the dump
+    int64_t value = 0;      // value number, constant, slot offset below the frame base or string label
+
+    bool is(Kind k) const {
+        return kind == k;
+    }
+};
+
+inline IrOperand ir_value(uint32_t value){
+    IrOperand o;
+    o.kind = IrOperand::Kind::VALUE;
+    o.value = value;
+    return o;
+}
+
+inline IrOperand ir_const(int64_t value){
+    IrOperand o;
+    o.kind = IrOperand::Kind::CONST;
+    o.value = value;
+    return o;
+}
+
+inline IrOperand ir_slot(int offset, symbol_id name){
+    IrOperand o;
+    o.kind = IrOperand::Kind::SLOT;
+    o.name = name;
+    o.value = offset;
+    return o;
+}
+
+inline IrOperand ir_string(int label){
+    IrOperand o;
+    o.kind = IrOperand::Kind::STRING;
+    o.value = label;
+    return o;
+}
+
+// INSTRUCTION
+// - a is the slot of loads and stores, the condition of branches
+struct IrInstr{
+    static const uint32_t NO_VALUE = UINT32_MAX;
+
+    IrOp op;
+    data_type type = data_type::UNKNOWN;
+    uint32_t dst = NO_VALUE;    // value defined
+    IrOperand a;
+    IrOperand b;
+    uint32_t target = 0;        // block jumped to, or branched to when the condition holds
+    uint32_t otherwise = 0;     // block branched to when it does not
+};
+
+struct IrBlock{
+    std::vector<IrInstr> code;
+};
+
+// CLASS : IR program
+// - the top level of a program, block 0 is its entry
+class IrProgram{
+public:
+    std::vector<IrBlock> blocks;
+    uint32_t values = 0;        // values handed out
+    int frameSize = 0;          // stack bytes for the slots of every scope, 16-byte aligned
+
+    size_t size() const {
+        size_t instructions = 0;
+        for(const IrBlock& block : blocks){
+            instructions += block.code.size();
+        }
+        return instructions;
+    }
+
+    // Method to print the blocks, one instruction per line
+    void print(std::ostream& os) const {
+        os << "frame " << frameSize << ", values " << values << "\n";
+        for(size_t b = 0; b < blocks.size(); b++){
+            os << "b" << b << ":\n";
+            for(const IrInstr& in : blocks[b].code){
+                print_instruction(os, in);
+            }
+        }
+    }
+
+private:
+    static void print_operand(std::ostream& os, const IrOperand& o){
+        switch(o.kind){
+            case IrOperand::Kind::NONE:
+                break;
+            case IrOperand::Kind::VALUE:
+                os << "%" << o.value;
+                break;
+            case IrOperand::Kind::CONST:
+                os << o.value;
+                break;
+            case IrOperand::Kind::SLOT:
+                os << "[" << SYMBOLS->name(o.name) << "@" << o.value << "]";
+                break;
+            case IrOperand::Kind::STRING:
+                os << "str_" << o.value;
+                break;
+        }
+    }
+
+    static void print_instruction(std::ostream& os, const IrInstr& in){
+        os << "    ";
+        if(in.dst != IrInstr::NO_VALUE){
+            os << "%" << in.dst << " = ";
+        }
+        os << ir_op_name(in.op);
+        switch(in.op){
+            case IrOp::JMP:
+                os << " b" << in.target;
+                break;
+            case IrOp::BR:
+                os << " " << ir_type_name(in.type) << " ";
+                print_operand(os, in.a);
+                os << ", b" << in.target << ", b" << in.otherwise;
+                break;
+            case IrOp::RET:
+                break;
+            default:
+                os << " " << ir_type_name(in.type) << " ";
+                print_operand(os, in.a);
+                if(!in.b.is(IrOperand::Kind::NONE)){
+                    os << ", ";
+                    print_operand(os, in.b);
+                }
+                break;
+        }
+        os << "\n";
+    }
+};
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// SECTION : IR BUILDER
+// - one pass over the resolved top level of a program, in the order the code runs
+// - literals become constant operands, every other expression a value
+// - of the two sides of an operator, the one that needs more registers goes first (Sethi-Ullman), unless
+//   something below assigns or calls, then the order is left to right
+// - the types of untyped variables are inferred from their first assignment, as in the other backends
+//-----------------------------------------------------------------------------------------------------------------------------
+
+// CLASS : IR builder
+class IrBuilder{
+public:
+    IrProgram build(const AST_program* program){
+        this->program = program;
+        out = IrProgram();
+        writeName = SYMBOLS->intern("write");
+        layout.clear();
+        current = new_block();
+        layout.push_back(current);
+
+        frame = aligned_scope_size(SYMBOL_TABLE->scope_size);
+        out.frameSize = frame;
+        for(node_id expr : program->expressions){
+            statement(expr);
+        }
+        emit(IrOp::RET);
+        renumber();
+        return std::move(out);
+    }
+
+private:
+    // a value or a constant of a known type
+    struct Value{
+        IrOperand operand;
+        data_type type;
+    };
+
+    const AST_program* program = nullptr;
+    IrProgram out;
+    symbol_id writeName = 0;
+    uint32_t current = 0;               // block being built
+    std::vector<uint32_t> layout;       // blocks in the order they were started
+    int frame = 0;                      // stack bytes of the enclosing scopes, as the resolver counted them
+
+    //-------------------------------------------------------------------------------------------------------------------------
+    // Emitting
+
+    uint32_t new_block(){
+        out.blocks.emplace_back();
+        return (uint32_t)out.blocks.size() - 1;
+    }
+
+    // the blocks are laid out in the order they are started, whatever order they were made in
+    void start(uint32_t block){
+        current = block;
+        layout.push_back(block);
+    }
+
+    IrInstr& emit(IrOp op, data_type type = data_type::UNKNOWN, IrOperand a = IrOperand(), IrOperand b = IrOperand()){
+        out.blocks[current].code.push_back(IrInstr{op, type, IrInstr::NO_VALUE, a, b});
+        return out.blocks[current].code.back();
+    }
+
+    IrOperand define(IrOp op, data_type type, IrOperand a, IrOperand b = IrOperand()){
+        IrInstr& in = emit(op, type, a, b);
+        in.dst = out.values++;
+        return ir_value(in.dst);
+    }
+
+    void jump(uint32_t target){
+        emit(IrOp::JMP).target = target;
+    }
+
+    void branch(const Value& condition, uint32_t target, uint32_t otherwise){
+        IrInstr& in = emit(IrOp::BR, condition.type, condition.operand);
+        in.target = target;
+        in.otherwise = otherwise;
+    }
+
+    // block numbers become positions in the layout, so the dump reads top to bottom
+    void renumber(){
+        std::vector<uint32_t> position(out.blocks.size());
+        std::vector<IrBlock> blocks(out.blocks.size());
+        for(uint32_t i = 0; i < (uint32_t)layout.size(); i++){
+            position[layout[i]] = i;
+        }
+        for(uint32_t i = 0; i < (uint32_t)layout.size(); i++){
+            blocks[i] = std::move(out.blocks[layout[i]]);
+            for(IrInstr& in : blocks[i].code){
+                if(in.op == IrOp::JMP || in.op == IrOp::BR){
+                    in.target = position[in.target];
+                    in.otherwise = position[in.otherwise];
+                }
+            }
+        }
+        out.blocks.swap(blocks);
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------------
+    // Statements
+
+    void statement(node_id expr){
+        switch(program->type(expr)){
+            case AST_type::BLOCK:
+                block(expr);
+                break;
+            case AST_type::CONDITIONAL:
+                conditional(expr);
+                break;
+            case AST_type::LOOP:
+                loop(expr);
+                break;
+            case AST_type::FUNCTION:
+                throw std::runtime_error("Function not implemented yet");
+            case AST_type::RETURN:
+                throw std::runtime_error("Return not implemented yet");
+            default:
+                value(expr);
+                break;
+        }
+    }
+
+    // a block's slots are below those of the scopes around it, the frame is as deep as the deepest block
+    void block(node_id node){
+        int size = aligned_scope_size(program->scope(node)->scope_size);
+        frame += size;
+        out.frameSize = std::max(out.frameSize, frame);
+        for(node_id child : program->list(node)){
+            statement(child);
+        }
+        frame -= size;
+    }
+
+    void conditional(node_id node){
+        uint32_t end = new_block();
+        uint32_t branches = program->branches(node);
+        for(uint32_t i = 0; i < branches; i++){
+            node_id condition = program->condition(node, i);
+            uint32_t next = end;
+            if(condition != NO_NODE){
+                uint32_t body = new_block();
+                next = i + 1 < branches ? new_block() : end;
+                branch_on(condition, body, next);
+                start(body);
+            }
+            block(program->body(node, i));
+            jump(end);
+            if(next != end){
+                start(next);
+            }
+        }
+        start(end);
+    }
+
+    // the condition is tested at the bottom, so an iteration runs one branch
+    void loop(node_id node){
+        uint32_t body = new_block();
+        uint32_t condition = new_block();
+        uint32_t exit = new_block();
+        jump(condition);
+        start(body);
+        block(program->body(node));
+        jump(condition);
+        start(condition);
+        branch_on(program->condition(node), body, exit);
+        start(exit);
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------------
+    // Conditions
+
+    // Method to go to target when the condition holds and to otherwise when it does not
+    // - "a && b" fails as soon as a does and "a || b" holds as soon as a does, b gets a block of its own
+    void branch_on(node_id condition, uint32_t target, uint32_t otherwise){
+        if(program->type(condition) == AST_type::BINARY){
+            AST_op op = program->op(condition);
+            if(op == AST_op::AND || op == AST_op::OR){
+                uint32_t rhs = new_block();
+                if(op == AST_op::AND){
+                    branch_on(program->lhs(condition), rhs, otherwise);
+                }else{
+                    branch_on(program->lhs(condition), target, rhs);
+                }
+                start(rhs);
+                branch_on(program->rhs(condition), target, otherwise);
+                return;
+            }
+        }
+        Value value = this->value(condition);
+        if(value.operand.is(IrOperand::Kind::NONE)){
+            throw std::runtime_error("Statement used as a value");
+        }
+        branch(value, target, otherwise);
+    }
+
+    //-------------------------------------------------------------------------------------------------------------------------
+    // Expressions
+
+    static void check_comparable(AST_op op, const Value& lhs, const Value& rhs){
+        bool ordered = op != AST_op::EQUAL && op != AST_op::NOT_EQUAL;
+        if(lhs.type != rhs.type || lhs.type == data_type::UNKNOWN || lhs.type == data_type::FLOAT
+            || (ordered && lhs.type != data_type::INTEGER && lhs.type != data_type::CHAR)){
+            throw std::runtime_error("Unsupported operation " + std::string(ast_op_name(op)) + " on these types");
+        }
+    }
+
+    Value value(node_id expr){
+        switch(program->type(expr)){
+            case AST_type::INTEGER:
+                return Value{ir_const(program->integer(expr)), data_type::INTEGER};
+            case AST_type::BOOLEAN:
+                return Value{ir_const(program->boolean(expr) ? 1 : 0), data_type::BOOLEAN};
+            case AST_type::CHAR:
+                return Value{ir_const((unsigned char)program->character(expr)), data_type::CHAR};
+            case AST_type::STRING: {
+                auto it = stringLiterals->labels.find(program->string(expr));
+                if(it == stringLiterals->labels.end()){
+                    throw std::runtime_error("String literal not found in stringLiterals map");
+                }
+                return Value{ir_string(it->second), data_type::STRING};
+            }
+            case AST_type::FLOAT:
+                throw std::runtime_error("Float not implemented yet");
+            case AST_type::VARIABLE: {
+                data_type type = program->variable(expr)->type;
+                return Value{define(IrOp::LOAD, type, slot(expr)), type};
+            }
+            case AST_type::UNARY:
+                return unary(expr);
+            case AST_type::BINARY:
+                return binary(expr);
+            case AST_type::FUNCTION_CALL:
+                return call(expr);
+            default:
+                throw std::runtime_error("Statement used as a value");
+        }
+    }
+
+    IrOperand slot(node_id variable) const {
+        return ir_slot(program->offset(variable), program->name(variable));
+    }
+
+    Value unary(node_id node){
+        Value operand = value(program->operand(node));
+        AST_op op = program->op(node);
+        if(op == AST_op::PLUS || op == AST_op::MINUS){
+            if(operand.type != data_type::INTEGER){
+                throw std::runtime_error("Unsupported operation " + std::string(ast_op_name(op)) + " on non-integer types");
+            }
+            if(op == AST_op::PLUS){
+                return operand;
+            }
+            return Value{define(IrOp::NEG, data_type::INTEGER, operand.operand), data_type::INTEGER};
+        }
+        if(operand.type != data_type::BOOLEAN){
+            throw std::runtime_error("Unsupported operation ! on non-boolean types");
+        }
+        return Value{define(IrOp::NOT, data_type::BOOLEAN, operand.operand), data_type::BOOLEAN};
+    }
+
+    Value assignment(node_id node){
+        node_id variable = program->lhs(node);
+        if(program->type(variable) != AST_type::VARIABLE){
+            throw std::runtime_error("Left-hand side of assignment must be a variable");
+        }
+        metadata& data = *program->variable(variable);
+
+        Value rhs = value(program->rhs(node));
+        if(rhs.operand.is(IrOperand::Kind::NONE)){
+            throw std::runtime_error("Statement used as a value");
+        }
+        if(data.type == data_type::UNKNOWN){
+            data.type = rhs.type;
+        }else if(data.type != rhs.type){
+            throw std::runtime_error("Unsupported operation = on non-matching types");
+        }
+        emit(IrOp::STORE, data.type, slot(variable), rhs.operand);
+        return rhs;
+    }
+
+    // the result is a bool both branches copy into, the right side only runs when the left does not decide it
+    Value logical(node_id node){
+        AST_op op = program->op(node);
+        Value lhs = value(program->lhs(node));
+        if(lhs.type != data_type::BOOLEAN){
+            throw std::runtime_error("Unsupported operation " + std::string(ast_op_name(op)) + " on non-boolean types");
+        }
+        IrOperand result = define(IrOp::COPY, data_type::BOOLEAN, lhs.operand);
+        uint32_t rhsBlock = new_block();
+        uint32_t end = new_block();
+        if(op == AST_op::AND){
+            branch(Value{result, data_type::BOOLEAN}, rhsBlock, end);
+        }else{
+            branch(Value{result, data_type::BOOLEAN}, end, rhsBlock);
+        }
+
+        start(rhsBlock);
+        Value rhs = value(program->rhs(node));
+        if(rhs.type != data_type::BOOLEAN){
+            throw std::runtime_error("Unsupported operation " + std::string(ast_op_name(op)) + " on non-boolean types");
+        }
+        IrInstr& copy = emit(IrOp::COPY, data_type::BOOLEAN, rhs.operand);
+        copy.dst = (uint32_t)result.value;
+        jump(end);
+        start(end);
+        return Value{result, data_type::BOOLEAN};
+    }
+
+    Value binary(node_id node){
+        AST_op op = program->op(node);
+        if(op == AST_op::ASSIGN){
+            return assignment(node);
+        }
+        if(op == AST_op::AND || op == AST_op::OR){
+            return logical(node);
+        }
+
+        node_id left = program->lhs(node), right = program->rhs(node);
+        Value lhs, rhs;
+        if(program->registers[right] > program->registers[left] && !program->effects[node]){
+            rhs = value(right);
+            lhs = value(left);
+        }else{
+            lhs = value(left);
+            rhs = value(right);
+        }
+
+        if(is_comparison(op)){
+            check_comparable(op, lhs, rhs);
+            IrOp code = op == AST_op::EQUAL ? IrOp::EQ : op == AST_op::NOT_EQUAL ? IrOp::NE : op == AST_op::LESS ? IrOp::LT
+                      : op == AST_op::LESS_EQUAL ? IrOp::LE : op == AST_op::GREATER ? IrOp::GT : IrOp::GE;
+            return Value{define(code, lhs.type, lhs.operand, rhs.operand), data_type::BOOLEAN};
+        }
+
+        IrOp code;
+        switch(op){
+            case AST_op::PLUS: code = IrOp::ADD; break;
+            case AST_op::MINUS: code = IrOp::SUB; break;
+            case AST_op::TIMES: code = IrOp::MUL; break;
+            case AST_op::DIVIDE: code = IrOp::DIV; break;
+            case AST_op::MODULO: code = IrOp::MOD; break;
+            default: throw std::runtime_error("Unsupported operator " + std::string(ast_op_name(op)));
+        }
+        if(lhs.type != data_type::INTEGER || rhs.type != data_type::INTEGER){
+            throw std::runtime_error("Unsupported operation " + std::string(ast_op_name(op)) + " on non-integer types");
+        }
+        return Value{define(code, data_type::INTEGER, lhs.operand, rhs.operand), data_type::INTEGER};
+    }
+
+    Value call(node_id node){
+        if(program->name(node) == writeName){
+            for(node_id param : program->list(node)){
+                Value arg = value(param);
+                if(arg.type != data_type::INTEGER && arg.type != data_type::CHAR
+                    && arg.type != data_type::BOOLEAN && arg.type != data_type::STRING){
+                    throw std::runtime_error("Unsupported argument type in write");
+                }
+                emit(IrOp::WRITE, arg.type, arg.operand);
+            }
+            return Value{IrOperand(), data_type::UNKNOWN};
+        }
+        throw std::runtime_error("Function call not implemented yet");
+    }
+};
+
+// FUNCTION : build ir
+// - builds the IR of the top level of a resolved program
+IrProgram build_ir(const AST_program* program){
+    IrBuilder builder;
+    return builder.build(program);
+}
+
+#endif // IR_HPP
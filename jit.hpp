@@ -0,0 +1,90 @@
+#ifndef JIT_HPP
+#define JIT_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#include "encoder.hpp"
+#include "x86.hpp"
+
+#if defined(__linux__) && defined(__x86_64__)
+#define ION_HAS_JIT 1
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// SECTION : JIT
+// - runs a program in this process, the code and data are mapped next to each other and the code is called as a function
+// - the ELF64 runtime writes through syscalls, so this needs Linux on x86-64
+//-----------------------------------------------------------------------------------------------------------------------------
+
+// CLASS : JIT program
+// - encodes, maps and links an instruction list built with Emit::JIT, the mapping lives as long as the object
+class JitProgram{
+public:
+    JitProgram(const InstrList& list, uint32_t entry){
+#ifdef ION_HAS_JIT
+        X86Encoder encoder;
+        encoder.encode(list);
+        if(encoder.labelOffsets[entry] < 0){
+            throw std::runtime_error("Entry point never placed");
+        }
+
+        // code pages first, data on the pages after them so each keeps its own protection
+        size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        textSize = (encoder.text.size() + page - 1) / page * page;
+        size = textSize + (list.data.size() + page - 1) / page * page;
+        void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(memory == MAP_FAILED){
+            throw std::runtime_error("Cannot map memory for the JIT");
+        }
+        base = (uint8_t*)memory;
+
+        encoder.link(list, (uint64_t)base, (uint64_t)(base + textSize));
+        std::memcpy(base, encoder.text.data(), encoder.text.size());
+        std::memcpy(base + textSize, list.data.data(), list.data.size());
+        if(mprotect(base, textSize, PROT_READ | PROT_EXEC) != 0){
+            munmap(base, size);
+            throw std::runtime_error("Cannot make JIT code executable");
+        }
+        function = (int (*)())(base + encoder.labelOffsets[entry]);
+        codeBytes = encoder.text.size();
+#else
+        (void)list;
+        (void)entry;
+        throw std::runtime_error("ion run needs Linux on x86-64");
+#endif
+    }
+
+    JitProgram(const JitProgram&) = delete;
+    JitProgram& operator=(const JitProgram&) = delete;
+
+    ~JitProgram(){
+#ifdef ION_HAS_JIT
+        if(base != nullptr){
+            munmap(base, size);
+        }
+#endif
+    }
+
+    // runs the program, returns 0 or the runtime error that stopped it
+    int run() const {
+        return function();
+    }
+
+    // bytes of machine code, without the page padding
+    size_t code_size() const {
+        return codeBytes;
+    }
+
+private:
+    uint8_t* base = nullptr;
+    size_t size = 0;
+    size_t textSize = 0;
+    size_t codeBytes = 0;
+    int (*function)() = nullptr;
+};
+
+#endif // JIT_HPP
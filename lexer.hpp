@@ -3,10 +3,15 @@
 
 #include <iostream>
 #include <string>
+#include <string_view>
+#include <array>
 #include <list>
+#include <vector>
 #include <stack>
 #include <queue>
 
+#include "scanner.hpp"
+
 //-----------------------------------------------------------------------------------------------------------------------------
 // SECTION : LEXICAL ANALYSIS
 //-----------------------------------------------------------------------------------------------------------------------------
@@ -28,9 +33,11 @@ enum class Token{
     CHAR_QUOTE, STRING_QUOTE, COMMA, SEMICOLON, COLON, OPEN_PAREN, CLOSE_PAREN, OPEN_BRACE, CLOSE_BRACE, OPEN_BRACKET, CLOSE_BRACKET,
 };
 
+// TOKEN DATA
+// - lexeme is a view into the source buffer, no allocation per token
 struct TokenData{
     Token token;
-    std::string lexeme = "";
+    std::string_view lexeme;
 };
 
 // FUNCTION : TOKEN PRINTING
@@ -84,21 +91,107 @@ std::ostream& operator<<(std::ostream& os, Token token) {
     return os;
 }
 
+// KEYWORD TABLE
+// - keywords are found with a perfect hash over (length, first char, last char)
+// - the table is built at compile time, a collision fails the build
+struct Keyword{
+    std::string_view text;
+    Token token;
+};
+
+constexpr Keyword KEYWORDS[] = {
+    {"int", Token::INT}, {"float", Token::FLOAT}, {"bool", Token::BOOL}, {"char", Token::CHAR},
+    {"string", Token::STRING}, {"void", Token::VOID},
+    {"let", Token::LET}, {"if", Token::IF}, {"else", Token::ELSE}, {"while", Token::WHILE},
+    {"return", Token::RETURN}, {"fn", Token::FUNCTION},
+    {"TRUE", Token::BOOL_literal}, {"FALSE", Token::BOOL_literal},
+};
+
+constexpr size_t KEYWORD_TABLE_SIZE = 32;
+
+constexpr size_t keyword_hash(std::string_view word){
+    return (word.size() * 2 + (unsigned char)word.front() + (unsigned char)word.back() * 8) & (KEYWORD_TABLE_SIZE - 1);
+}
+
+constexpr std::array<Keyword, KEYWORD_TABLE_SIZE> build_keyword_table(){
+    std::array<Keyword, KEYWORD_TABLE_SIZE> table{};
+    for(const Keyword& keyword : KEYWORDS){
+        table[keyword_hash(keyword.text)] = keyword;
+    }
+    return table;
+}
+
+constexpr std::array<Keyword, KEYWORD_TABLE_SIZE> KEYWORD_TABLE = build_keyword_table();
+
+constexpr bool keyword_table_is_perfect(){
+    for(const Keyword& keyword : KEYWORDS){
+        if(KEYWORD_TABLE[keyword_hash(keyword.text)].text != keyword.text){
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(keyword_table_is_perfect(), "Keyword hash collision: adjust keyword_hash");
+
+// FUNCTION : LOOKUP KEYWORD
+// - returns the keyword token for a non-empty word, IDENTIFIER otherwise
+inline Token lookup_keyword(std::string_view word){
+    const Keyword& keyword = KEYWORD_TABLE[keyword_hash(word)];
+    return keyword.text == word ? keyword.token : Token::IDENTIFIER;
+}
+
+// LEXER STATISTICS
+// - counts get_token calls against the bytes of source they were run over
+struct LexerStats{
+    long long calls = 0;
+    long long bytes = 0;
+
+    // Debugging purposes only
+    void print(std::ostream& os) const {
+        os << "Lexer: " << calls << " calls over " << bytes << " bytes ("
+           << (bytes ? (double)calls / bytes : 0.0) << " calls/byte)\n";
+    }
+};
+
+// Statistics of the compilation running on this thread
+thread_local LexerStats* LEX_STATS = nullptr;
+
+// FUNCTION : CHARACTER AT
+// - returns the character at index, or '\0' past the end of the source
+// - the source is a borrowed view, so it is not guaranteed to be null-terminated
+inline char char_at(std::string_view code, int index){
+    return index < (int)code.size() ? code[index] : '\0';
+}
+
 // FUNCTION :  GET TOKEN 
 // - returns the next token in the stream
-TokenData get_token(std::string code, int& index){
+// - lexemes are views into the source buffer, which must outlive the tokens
+TokenData get_token(std::string_view code, int& index){
     TokenData td;
     td.token = Token::UNDEFINED; // default token
+    LEX_STATS->calls++;
 
     // check for end of file
-    if(index >= code.size()){
+    if(index >= (int)code.size()){
         td.token = Token::END_OF_FILE;
         return td;
     }
 
     // skip leading whitespace
-    while(code[index] == ' ' || code[index] == '\t'){
-        index++;
+    if(code[index] == ' ' || code[index] == '\t'){
+        index += skip_blanks(code.data() + index, code.size() - index);
+    }
+
+    // skip a comment up to the end of the line or statement
+    if(char_at(code, index) == '#'){
+        index += scan_until(code.data() + index, code.size() - index, '\n', ';');
+    }
+
+    // only whitespace or a comment left
+    if(index >= (int)code.size()){
+        td.token = Token::END_OF_FILE;
+        return td;
     }
     
     // check for new line
@@ -108,93 +201,39 @@ TokenData get_token(std::string code, int& index){
         return td;
     }
 
-    if(code[index] == '#'){
-        while(code[index] != '\n' && code[index] != ';'){
-            index++;
-        }
-        index--;
-    }
+    int start = index;
 
     // alphabet found
-    if(isalpha(code[index])){
-        while(isalnum(code[index]) || code[index] == '_'){
-            td.lexeme += code[index];
+    if(isalpha(char_at(code, index))){
+        while(isalnum(char_at(code, index)) || char_at(code, index) == '_'){
             index++;
         }
+        td.lexeme = code.substr(start, index - start);
 
-        if(td.lexeme == "int"){
-            td.token = Token::INT;
-        }
-        else if(td.lexeme == "float"){
-            td.token = Token::FLOAT;
-        }
-        else if(td.lexeme == "bool"){
-            td.token = Token::BOOL;
-        }
-        else if(td.lexeme == "char"){
-            td.token = Token::CHAR;
-        }
-        else if(td.lexeme == "string"){
-            td.token = Token::STRING;
-        }
-        else if(td.lexeme == "let"){
-            td.token = Token::LET;
-        }
-        else if(td.lexeme == "if"){
-            td.token = Token::IF;
-        }
-        else if(td.lexeme == "else"){
-            td.token = Token::ELSE;
-        }
-        else if(td.lexeme == "while"){
-            td.token = Token::WHILE;
-        }
-        else if(td.lexeme == "return"){
-            td.token = Token::RETURN;
-        }
-        else if(td.lexeme == "fn"){
-            td.token = Token::FUNCTION;
-        }
-        else if(td.lexeme == "void"){
-            td.token = Token::VOID;
-        }
-        else if(td.lexeme == "TRUE" || td.lexeme == "FALSE"){
-            td.token = Token::BOOL_literal;
-        }
-        else{
-            td.token = Token::IDENTIFIER;
-        }
-
-        int copy_index = index;
-        TokenData temp = get_token(code, copy_index);
-
-        if(temp.token == Token::OPEN_PAREN && td.token == Token::IDENTIFIER){
-            td.token = Token::CALL;
-        }
+        td.token = lookup_keyword(td.lexeme);
 
+        // an IDENTIFIER followed by '(' is turned into a CALL by tokenize
         return td;
-    }else if (isdigit(code[index])){
+    }else if (isdigit(char_at(code, index))){
         td.token = Token::INT_literal;
-        while(isdigit(code[index])){
-            td.lexeme += code[index];
+        while(isdigit(char_at(code, index))){
             index++;
         }
         
-        if(code[index] == '.'){
-            td.lexeme += code[index];
+        if(char_at(code, index) == '.'){
             index++;
-            while(isdigit(code[index])){
-                td.lexeme += code[index];
+            while(isdigit(char_at(code, index))){
                 index++;
             }
             td.token = Token::FLOAT_literal;
         }
+        td.lexeme = code.substr(start, index - start);
         return td;
     }
 
     // check for double operator first before single operator
-    td.lexeme += code[index];
-    switch(code[index]){
+    td.lexeme = code.substr(start, 1);
+    switch(char_at(code, index)){
         case '+':
             td.token = Token::SINGLE_OPERATOR;
             break;
@@ -211,50 +250,50 @@ TokenData get_token(std::string code, int& index){
             td.token = Token::SINGLE_OPERATOR;
             break;
         case '=':
-            if(code[index+1] == '='){
+            if(char_at(code, index+1) == '='){
                 td.token = Token::DOUBLE_COMPARATOR;
-                td.lexeme += code[index+1];
+                td.lexeme = code.substr(start, 2);
                 index++;
             }else
                 td.token = Token::SINGLE_OPERATOR;
             break;
         case '!':
-            if(code[index+1] == '='){
+            if(char_at(code, index+1) == '='){
                 td.token = Token::DOUBLE_COMPARATOR;
-                td.lexeme += code[index+1];
+                td.lexeme = code.substr(start, 2);
                 index++;
             }else
                 td.token = Token::SINGLE_OPERATOR;
             break;
         case '<':
-            if(code[index+1] == '='){
+            if(char_at(code, index+1) == '='){
                 td.token = Token::DOUBLE_COMPARATOR;
-                td.lexeme += code[index+1];
+                td.lexeme = code.substr(start, 2);
                 index++;
             }else
                 td.token = Token::SINGLE_COMPARATOR;
             break;
         case '>':
-            if(code[index+1] == '='){
+            if(char_at(code, index+1) == '='){
                 td.token = Token::DOUBLE_COMPARATOR;
-                td.lexeme += code[index+1];
+                td.lexeme = code.substr(start, 2);
                 index++;
             }else
                 td.token = Token::SINGLE_COMPARATOR;
             break;
         case '&':
-            if(code[index+1] == '&'){
+            if(char_at(code, index+1) == '&'){
                 td.token = Token::DOUBLE_OPERATOR;
-                td.lexeme += code[index+1];
+                td.lexeme = code.substr(start, 2);
                 index++;
             }else{
                 td.token = Token::SINGLE_OPERATOR;
             }
             break;
         case '|':
-            if(code[index+1] == '|'){
+            if(char_at(code, index+1) == '|'){
                 td.token = Token::DOUBLE_OPERATOR;
-                td.lexeme += code[index+1];
+                td.lexeme = code.substr(start, 2);
                 index++;
             }else{
                 td.token = Token::SINGLE_OPERATOR;
@@ -289,20 +328,16 @@ TokenData get_token(std::string code, int& index){
             break;
         case '\'':
             index++;
-            td.lexeme = "";
-            while(code[index] != '\''){
-                td.lexeme += code[index];
-                index++;
-            }
+            start = index;
+            index += scan_until(code.data() + index, code.size() - index, '\'', '\'');
+            td.lexeme = code.substr(start, index - start);
             td.token = Token::CHAR_literal;
             break;
         case '\"':
             index++;
-            td.lexeme = "";
-            while(code[index] != '\"'){
-                td.lexeme += code[index];
-                index++;
-            }
+            start = index;
+            index += scan_until(code.data() + index, code.size() - index, '\"', '\"');
+            td.lexeme = code.substr(start, index - start);
             td.token = Token::STRING_literal;
             break;
     }
@@ -311,4 +346,69 @@ TokenData get_token(std::string code, int& index){
     return td;
 }
 
+// FUNCTION : TOKENIZE
+// - lexes the whole source in a single pass
+// - the stream always ends with an END_OF_FILE token
+std::vector<TokenData> tokenize(std::string_view code){
+    std::vector<TokenData> tokens;
+    tokens.reserve(code.size() / 4 + 1);
+    LEX_STATS->bytes += code.size();
+
+    int index = 0;
+    TokenData td;
+    do{
+        td = get_token(code, index);
+
+        // an identifier directly followed by an open paren is a function call
+        if(td.token == Token::OPEN_PAREN && !tokens.empty() && tokens.back().token == Token::IDENTIFIER){
+            tokens.back().token = Token::CALL;
+        }
+        tokens.push_back(td);
+    }while(td.token != Token::END_OF_FILE);
+
+    return tokens;
+}
+
+// FUNCTION : DUMP TOKENS
+// - lexes the source on its own and prints one token per line, for DEBUGGING purposes only
+void dump_tokens(std::string_view code, std::ostream& os){
+    for(const TokenData& td : tokenize(code)){
+        os << td.token;
+        if(td.token != Token::NEW_LINE && td.token != Token::END_OF_FILE){
+            os << " " << td.lexeme;
+        }
+        os << "\n";
+    }
+}
+
+// CLASS : TOKEN STREAM
+// - parser cursor over the pre-lexed tokens with O(1) lookahead
+class TokenStream{
+private:
+    std::vector<TokenData> tokens;
+    size_t position = 0;
+
+public:
+    TokenStream(std::string_view code) : tokens(tokenize(code)) {}
+
+    // Look k tokens ahead without consuming, END_OF_FILE past the end
+    const TokenData& peek(size_t k = 0) const {
+        size_t i = position + k;
+        return i < tokens.size() ? tokens[i] : tokens.back();
+    }
+
+    // Consume and return the current token
+    TokenData advance(){
+        const TokenData& td = peek();
+        if(position < tokens.size() - 1){
+            position++;
+        }
+        return td;
+    }
+
+    size_t size() const {
+        return tokens.size();
+    }
+};
+
 #endif // LEXER_HPP
\ No newline at end of file
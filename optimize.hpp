@@ -0,0 +1,207 @@
+#ifndef OPTIMIZE_HPP
+#define OPTIMIZE_HPP
+
+#include <cstdint>
+
+#include "ast.hpp"
+#include "table.hpp"
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// SECTION : AST OPTIMIZATION
+// - runs at -O1 between name resolution and code generation, so both the native code and the bytecode see its result
+// - folds operators whose operands are all literals, integers wrap at 32 bits like they do at run time
+// - drops operations that change nothing (x + 0, x - 0, x * 1, x / 1) and the ones whose result does not depend on x
+//   (x * 0, x % 1), only when x is an integer expression without side effects so no type error goes missing with it
+// - division and remainder by a literal 0 stay, they fail when the program runs
+// - multiplying and dividing by powers of two is left to instruction selection, which has shifts
+//-----------------------------------------------------------------------------------------------------------------------------
+
+class Optimizer{
+public:
+    long long replaced = 0;     // nodes replaced by a literal or by one of their operands
+
+    explicit Optimizer(AST_program* program) : program(program) {}
+
+    void optimize_program(){
+        for(node_id& expr : program->expressions){
+            expr = optimize(expr);
+        }
+    }
+
+    // returns the node that takes the place of node, node itself when it stays
+    node_id optimize(node_id node){
+        switch(program->type(node)){
+            case AST_type::UNARY:
+                return optimize_unary(node);
+            case AST_type::BINARY:
+                return optimize_binary(node);
+            case AST_type::BLOCK:
+                optimize_block(node);
+                break;
+            case AST_type::CONDITIONAL:
+                for(uint32_t i = 0; i < program->branches(node); i++){
+                    uint32_t condition = program->b[node] + 2 * i;
+                    if(program->lists[condition] != NO_NODE){
+                        program->lists[condition] = optimize(program->lists[condition]);
+                    }
+                    optimize_block(program->body(node, i));
+                }
+                break;
+            case AST_type::LOOP:
+                program->a[node] = optimize(program->condition(node));
+                optimize_block(program->body(node));
+                break;
+            case AST_type::FUNCTION:
+                optimize_block(program->body(node));
+                break;
+            case AST_type::RETURN:
+                program->a[node] = optimize(program->operand(node));
+                break;
+            default:
+                // literals and variables, call arguments are only ever those
+                break;
+        }
+        return node;
+    }
+
+private:
+    AST_program* program;
+
+    // lists never grow here, so their slots can be written while walking them
+    void optimize_block(node_id block){
+        uint32_t first = program->b[block];
+        for(uint32_t i = 0; i < program->c[block]; i++){
+            program->lists[first + i] = optimize(program->lists[first + i]);
+        }
+    }
+
+    static int32_t wrap(int64_t value){
+        return (int32_t)(uint32_t)(uint64_t)value;
+    }
+
+    bool is_literal(node_id node, int value) const {
+        return program->type(node) == AST_type::INTEGER && program->integer(node) == value;
+    }
+
+    static bool is_arithmetic(AST_op op){
+        return op == AST_op::PLUS || op == AST_op::MINUS || op == AST_op::TIMES || op == AST_op::DIVIDE || op == AST_op::MODULO;
+    }
+
+    // whether an expression is an integer, as far as its type is known before code generation
+    bool is_integer(node_id node) const {
+        switch(program->type(node)){
+            case AST_type::INTEGER:
+                return true;
+            case AST_type::VARIABLE: {
+                const metadata* data = program->variable(node);
+                return data != nullptr && data->type == data_type::INTEGER;
+            }
+            case AST_type::UNARY:
+                return (program->op(node) == AST_op::MINUS || program->op(node) == AST_op::PLUS) &&
+                    is_integer(program->operand(node));
+            case AST_type::BINARY:
+                return is_arithmetic(program->op(node)) && is_integer(program->lhs(node)) && is_integer(program->rhs(node));
+            default:
+                return false;
+        }
+    }
+
+    // the node itself becomes the literal, its operands are left unreferenced
+    node_id integer(node_id node, int64_t value){
+        replaced++;
+        program->set_integer(node, wrap(value));
+        return node;
+    }
+
+    node_id boolean(node_id node, bool value){
+        replaced++;
+        program->set_boolean(node, value);
+        return node;
+    }
+
+    node_id operand(node_id node){
+        replaced++;
+        return node;
+    }
+
+    node_id optimize_unary(node_id node){
+        program->a[node] = optimize(program->operand(node));
+        node_id expr = program->operand(node);
+        AST_op op = program->op(node);
+        if(program->type(expr) == AST_type::INTEGER){
+            int64_t value = program->integer(expr);
+            if(op == AST_op::MINUS) return integer(node, -value);
+            if(op == AST_op::PLUS) return integer(node, value);
+        }
+        if(program->type(expr) == AST_type::BOOLEAN && op == AST_op::NOT){
+            return boolean(node, !program->boolean(expr));
+        }
+        program->measure(node);
+        return node;
+    }
+
+    node_id optimize_binary(node_id node){
+        program->a[node] = optimize(program->lhs(node));
+        program->b[node] = optimize(program->rhs(node));
+        AST_op op = program->op(node);
+        node_id lhs = program->lhs(node);
+        node_id rhs = program->rhs(node);
+
+        if(program->type(lhs) == AST_type::INTEGER && program->type(rhs) == AST_type::INTEGER){
+            int64_t a = program->integer(lhs);
+            int64_t b = program->integer(rhs);
+            switch(op){
+                case AST_op::PLUS: return integer(node, a + b);
+                case AST_op::MINUS: return integer(node, a - b);
+                case AST_op::TIMES: return integer(node, a * b);
+                case AST_op::DIVIDE: if(b != 0) return integer(node, a / b); break;
+                case AST_op::MODULO: if(b != 0) return integer(node, a % b); break;
+                case AST_op::EQUAL: return boolean(node, a == b);
+                case AST_op::NOT_EQUAL: return boolean(node, a != b);
+                case AST_op::LESS: return boolean(node, a < b);
+                case AST_op::LESS_EQUAL: return boolean(node, a <= b);
+                case AST_op::GREATER: return boolean(node, a > b);
+                case AST_op::GREATER_EQUAL: return boolean(node, a >= b);
+                default: break;
+            }
+        }
+
+        if(program->type(lhs) == AST_type::BOOLEAN && program->type(rhs) == AST_type::BOOLEAN){
+            bool a = program->boolean(lhs);
+            bool b = program->boolean(rhs);
+            switch(op){
+                case AST_op::AND: return boolean(node, a && b);
+                case AST_op::OR: return boolean(node, a || b);
+                case AST_op::EQUAL: return boolean(node, a == b);
+                case AST_op::NOT_EQUAL: return boolean(node, a != b);
+                default: break;
+            }
+        }
+
+        // identities, the operand that stays has to be an integer for the operation to have been valid
+        if(is_arithmetic(op) && is_integer(lhs) && is_integer(rhs)){
+            bool additive = op == AST_op::PLUS || op == AST_op::MINUS;
+            bool multiplicative = op == AST_op::TIMES || op == AST_op::DIVIDE;
+            if(additive && is_literal(rhs, 0)) return operand(lhs);
+            if(op == AST_op::PLUS && is_literal(lhs, 0)) return operand(rhs);
+            if(multiplicative && is_literal(rhs, 1)) return operand(lhs);
+            if(op == AST_op::TIMES && is_literal(lhs, 1)) return operand(rhs);
+            if(op == AST_op::TIMES && is_literal(rhs, 0) && !program->effects[lhs]) return integer(node, 0);
+            if(op == AST_op::TIMES && is_literal(lhs, 0) && !program->effects[rhs]) return integer(node, 0);
+            if(op == AST_op::MODULO && is_literal(rhs, 1) && !program->effects[lhs]) return integer(node, 0);
+        }
+
+        program->measure(node);
+        return node;
+    }
+};
+
+// FUNCTION : optimize program
+// - optimizes the tree of a resolved program in place, returns the number of nodes replaced
+long long optimize_program(AST_program* program){
+    Optimizer optimizer(program);
+    optimizer.optimize_program();
+    return optimizer.replaced;
+}
+
+#endif // OPTIMIZE_HPP
@@ -3,6 +3,9 @@
 
 #include <iostream>
 #include <string>
+#include <string_view>
+#include <charconv>
+#include <memory>
 #include <list>
 #include <stack>
 #include <queue>
@@ -15,6 +18,9 @@
 // SECTION : SYNTACTIC ANALYSIS
 //-----------------------------------------------------------------------------------------------------------------------------
 
+// Program the parser adds nodes to, set by parse_program
+thread_local AST_program* AST_TREE = nullptr;
+
 //-----------------------------------------------------------------------------------------------------------------------------
 // SUBSECTION : HELPER FUNCTIONS
 
@@ -30,85 +36,114 @@ int precedence(const TokenData& t){
     return 1;
 }
 
-bool is_assignable(AST_expression* expr) {
+// Function : Lexeme to number
+// - converts a numeric lexeme without copying it into a temporary string
+int lexeme_to_int(std::string_view lexeme){
+    int value = 0;
+    auto result = std::from_chars(lexeme.data(), lexeme.data() + lexeme.size(), value);
+    if(result.ec != std::errc()){
+        throw std::runtime_error("Invalid integer literal: " + std::string(lexeme));
+    }
+    return value;
+}
+
+float lexeme_to_float(std::string_view lexeme){
+    float value = 0;
+    auto result = std::from_chars(lexeme.data(), lexeme.data() + lexeme.size(), value);
+    if(result.ec != std::errc()){
+        throw std::runtime_error("Invalid float literal: " + std::string(lexeme));
+    }
+    return value;
+}
+
+bool is_assignable(node_id expr) {
     // An expression is assignable if it's a variable
-    return expr->type == AST_type::VARIABLE;
+    return AST_TREE->type(expr) == AST_type::VARIABLE;
 }
 
 // END OF HELPER FUNCTIONS
 //-----------------------------------------------------------------------------------------------------------------------------
 
-AST_program* parse_program(std::string&);
-AST_expression* parse_declaration(std::string&, int&);
-AST_expression* parse_expression(std::string&, int&, bool);
-AST_expression* build_expression(std::queue<TokenData>& operand_queue);
-AST_expression* parse_block(std::string&, int&, bool);
-AST_expression* parse_function(std::string&, int&);
-AST_expression* parse_conditional(std::string&, int&);
-AST_expression* parse_loop(std::string&, int&);
-AST_expression* parse_return(std::string&, int&);
+AST_program* parse_program(TokenStream&);
+node_id parse_declaration(TokenStream&);
+node_id parse_expression(TokenStream&, bool);
+node_id build_expression(std::queue<TokenData>& operand_queue);
+node_id parse_block(TokenStream&, bool);
+node_id parse_function(TokenStream&);
+node_id parse_conditional(TokenStream&);
+node_id parse_loop(TokenStream&);
+node_id parse_return(TokenStream&);
 
 //  PARSE : Program
-//  - this parses the entire program
-AST_program* parse_program(std::string &code){    
-    AST_program* program = new AST_program();
-
-    int index = 0;
-    while(index < code.size()){
-        int copy_index = index;
-        TokenData td = get_token(code, copy_index);
-        if(td.token == Token::NEW_LINE || td.token == Token::SEMICOLON || code[index] == ' ' || code[index] == '\t'){
-            index++;
+//  - this parses the entire program from an already lexed token stream
+//  - the program, and the node table in it, is freed if parsing throws
+AST_program* parse_program(TokenStream& ts){
+    std::unique_ptr<AST_program> program(new AST_program());
+    AST_TREE = program.get();
+    // every node comes from at least one token, so the table never grows while parsing
+    program->reserve(ts.size());
+
+    while(ts.peek().token != Token::END_OF_FILE){
+        const TokenData& td = ts.peek();
+        if(td.token == Token::NEW_LINE || td.token == Token::SEMICOLON){
+            ts.advance();
             continue;
         }
 
         if(td.token == Token::LET){ // Declaration found
-            program->addExpression(parse_declaration(code, index));
+            program->expressions.push_back(parse_declaration(ts));
         }else if (td.token == Token::FUNCTION){ // Function found
-            program->addExpression(parse_function(code, index));
+            program->expressions.push_back(parse_function(ts));
         }else if (td.token == Token::IF){ // Conditional found
-            program->addExpression(parse_conditional(code, index));
+            program->expressions.push_back(parse_conditional(ts));
         }else if (td.token == Token::WHILE){ // Loop found
-            program->addExpression(parse_loop(code, index));  
+            program->expressions.push_back(parse_loop(ts));  
         }else if (td.token == Token::OPEN_BRACE){ 
-            program->addExpression(parse_block(code, index, false));  // block found
+            program->expressions.push_back(parse_block(ts, false));  // block found
         }else if (td.token == Token::RETURN) { 
-            program->addExpression(parse_return(code, index)); // return found
+            program->expressions.push_back(parse_return(ts)); // return found
         }else{
-            program->addExpression(parse_expression(code, index, false));
+            program->expressions.push_back(parse_expression(ts, false));
         }
     }
-    return program;
+    return program.release();
+}
+
+//  PARSE : Program
+//  - lexes and parses the entire program
+AST_program* parse_program(std::string_view code){
+    TokenStream ts(code);
+    return parse_program(ts);
 }
 
 //  PARSE: Declarations
 //  - this parses a declaration
-AST_expression* parse_declaration(std::string &code, int& index){
-    AST_expression *LHS, *RHS;
-    TokenData t = get_token(code, index);
+node_id parse_declaration(TokenStream& ts){
+    node_id LHS, RHS;
+    TokenData t = ts.advance();
 
-    std::string name;
+    symbol_id name;
     metadata data;
 
     if(t.token != Token::LET){
         // Error
         throw std::runtime_error("Expected keyword LET in a declaration");
-        return nullptr;
+        return NO_NODE;
     }
     
     // get the Variable
-    t = get_token(code, index);
+    t = ts.advance();
     if(t.token == Token::IDENTIFIER){
-        LHS = new AST_variable(t.lexeme);
-        name = t.lexeme;
+        name = SYMBOLS->intern(t.lexeme);
+        LHS = AST_TREE->add_variable(name);
     }else{
         // Error
         throw std::runtime_error("Expected identifier");
     }
 
-    t = get_token(code, index);
+    t = ts.advance();
     if(t.token == Token::COLON){ // colon, expect data type
-        t = get_token(code, index);
+        t = ts.advance();
 
         if(t.token == Token::INT){
             // LHS is an integer
@@ -135,7 +170,7 @@ AST_expression* parse_declaration(std::string &code, int& index){
             throw std::runtime_error("Expected data type");
         }
         
-        t = get_token(code, index);
+        t = ts.advance();
     }else{
         // No data type
         data.type = data_type::UNKNOWN;
@@ -150,8 +185,8 @@ AST_expression* parse_declaration(std::string &code, int& index){
         return LHS;
     }else if(t.token == Token::SINGLE_OPERATOR && t.lexeme == "="){
         // RHS is a binary expression
-        RHS = parse_expression(code, index, false);
-        AST_expression* binOpDeclartion = new AST_binary("=", LHS, RHS);
+        RHS = parse_expression(ts, false);
+        node_id binOpDeclartion = AST_TREE->add_binary(AST_op::ASSIGN, LHS, RHS);
         return binOpDeclartion;
     }else{
         // Error
@@ -159,23 +194,22 @@ AST_expression* parse_declaration(std::string &code, int& index){
     }
 
 
-    return nullptr;   
+    return NO_NODE;   
 }
 
 //  PARSE: Expression
 //  - this parses a general expression. This could be:
 //  - Binary operation, function call, variables, literals
 //  - This is implemented using the Shunting Yard algorithm
-AST_expression* parse_expression(std::string &code, int& index, bool condition = false){
-    TokenData t = get_token(code, index);
+node_id parse_expression(TokenStream& ts, bool condition = false){
+    TokenData t = ts.advance();
     TokenData lastToken;
-    lastToken.lexeme = "";
     lastToken.token = Token::UNDEFINED;
     std::stack <TokenData> operator_stack;
     std::queue <TokenData> operand_queue;
-    AST_expression* expr = nullptr;
+    node_id expr = NO_NODE;
 
-    while(t.token != Token::NEW_LINE && t.token != Token::SEMICOLON){        
+    while(t.token != Token::NEW_LINE && t.token != Token::SEMICOLON && t.token != Token::END_OF_FILE){        
         if(t.token == Token::OPEN_PAREN){
             operator_stack.push(t);
         }else if(t.token == Token::CLOSE_PAREN){
@@ -229,13 +263,13 @@ AST_expression* parse_expression(std::string &code, int& index, bool condition =
             operator_stack.push(t);
         }else if (t.token == Token::CALL){
             operand_queue.push(t);
-            TokenData temp = get_token(code, index);
+            TokenData temp = ts.advance();
 
             if(temp.token == Token::OPEN_PAREN){
                 operand_queue.push(temp);
             }
             
-            temp = get_token(code, index);
+            temp = ts.advance();
             while(temp.token != Token::CLOSE_PAREN){
                 if(temp.token == Token::COMMA 
                 || temp.token == Token::IDENTIFIER
@@ -250,13 +284,13 @@ AST_expression* parse_expression(std::string &code, int& index, bool condition =
                     // Error
                     throw std::runtime_error("Invalid parameter");
                 }
-                temp = get_token(code, index);
+                temp = ts.advance();
             }
             operand_queue.push(temp);
         }
 
         lastToken = t;
-        t = get_token(code, index);
+        t = ts.advance();
     }
 
     while(!operator_stack.empty()){
@@ -272,7 +306,7 @@ AST_expression* parse_expression(std::string &code, int& index, bool condition =
 
     expr = build_expression(operand_queue);
 
-    if(expr == nullptr){
+    if(expr == NO_NODE){
         // Error
         throw std::runtime_error("Invalid expression");
     }
@@ -283,14 +317,15 @@ AST_expression* parse_expression(std::string &code, int& index, bool condition =
 // BUILD EXPRESSION
 // - this builds the expression from the queue of tokens
 // - this is used by the Shunting Yard algorithm
-AST_expression*     build_expression(std::queue<TokenData>& operand_queue) {
-    std::stack<AST_expression*> ast_stack;
+// - adds each node to the table of the program being parsed as soon as its operands are there
+node_id     build_expression(std::queue<TokenData>& operand_queue) {
+    std::stack<node_id> ast_stack;
 
     while (!operand_queue.empty()) {
         TokenData t = operand_queue.front();
         // std::cout << t.token << " " << t.lexeme << std::endl;
         operand_queue.pop();
-        AST_expression* node;
+        node_id node;
 
         // If the token is an operator, pop operands from the stack
         if (t.token == Token::SINGLE_OPERATOR ||
@@ -302,8 +337,8 @@ AST_expression*     build_expression(std::queue<TokenData>& operand_queue) {
                 // Error
                 throw std::runtime_error("Not enough operands for operator");
             }
-            AST_expression* right = ast_stack.top(); ast_stack.pop();
-            AST_expression* left = ast_stack.top(); ast_stack.pop();
+            node_id right = ast_stack.top(); ast_stack.pop();
+            node_id left = ast_stack.top(); ast_stack.pop();
 
             // Check if the operator is an assignment operator and if the LHS is assignable
             if (t.lexeme == "=") {
@@ -314,42 +349,43 @@ AST_expression*     build_expression(std::queue<TokenData>& operand_queue) {
             }
 
             // Set the children of the operator node
-            node = new AST_binary(t.lexeme, left, right);
+            node = AST_TREE->add_binary(ast_op_of(t.lexeme), left, right);
         }else if (t.token == Token::UNARY_OPERATOR) { 
             if (ast_stack.empty()) {
                 // Error
                 throw std::runtime_error("No operand for unary operator");
             }
 
-            AST_expression* operand = ast_stack.top(); ast_stack.pop();
-            node = new AST_unary(t.lexeme, operand);
+            node_id operand = ast_stack.top(); ast_stack.pop();
+            node = AST_TREE->add_unary(ast_op_of(t.lexeme), operand);
         }else {
             // Handling for operand tokens
-            std::list<AST_expression*> parameters;
+            uint32_t parameters;
             TokenData temp;
 
             switch (t.token) {
                 case Token::INT_literal:
-                    node = new AST_integer(std::stoi(t.lexeme));
+                    node = AST_TREE->add_integer(lexeme_to_int(t.lexeme));
                     break;
                 case Token::FLOAT_literal:
-                    node = new AST_float(std::stof(t.lexeme));
+                    node = AST_TREE->add_float(lexeme_to_float(t.lexeme));
                     break;
                 case Token::BOOL_literal:
-                    node = new AST_boolean(t.lexeme == "TRUE" ? true : false);
+                    node = AST_TREE->add_boolean(t.lexeme == "TRUE" ? true : false);
                     break;
                 case Token::CHAR_literal:
-                    node = new AST_char(t.lexeme[0]);
+                    node = AST_TREE->add_char(char_at(t.lexeme, 0));
                     break;
                 case Token::STRING_literal:
-                    node = new AST_string(t.lexeme);
-                    stringLiterals[t.lexeme] = "str_" + std::to_string(stringLiteralCounter++);
+                    node = AST_TREE->add_string(SYMBOLS->intern(t.lexeme));
+                    stringLiterals->add(AST_TREE->string(node));
                     break;
                 case Token::IDENTIFIER:
-                    node = new AST_variable(t.lexeme);
+                    node = AST_TREE->add_variable(SYMBOLS->intern(t.lexeme));
                     break;
                 case Token::CALL:
                     temp = t;
+                    parameters = AST_TREE->begin_list();
                     // Consume the open paren and add all parameters to the function call
                     t = operand_queue.front();
                     operand_queue.pop();
@@ -361,18 +397,19 @@ AST_expression*     build_expression(std::queue<TokenData>& operand_queue) {
                     operand_queue.pop();
                     while(t.token != Token::CLOSE_PAREN){
                         if(t.token == Token::IDENTIFIER){
-                            parameters.push_back(new AST_variable(t.lexeme));
+                            AST_TREE->push(AST_TREE->add_variable(SYMBOLS->intern(t.lexeme)));
                         }else if(t.token == Token::INT_literal){
-                            parameters.push_back(new AST_integer(std::stoi(t.lexeme)));
+                            AST_TREE->push(AST_TREE->add_integer(lexeme_to_int(t.lexeme)));
                         }else if(t.token == Token::FLOAT_literal){
-                            parameters.push_back(new AST_float(std::stof(t.lexeme)));
+                            AST_TREE->push(AST_TREE->add_float(lexeme_to_float(t.lexeme)));
                         }else if(t.token == Token::BOOL_literal) {
-                            parameters.push_back(new AST_boolean(t.lexeme == "TRUE" ? true : false));
+                            AST_TREE->push(AST_TREE->add_boolean(t.lexeme == "TRUE" ? true : false));
                         }else if(t.token == Token::CHAR_literal){
-                            parameters.push_back(new AST_char(t.lexeme[0]));
+                            AST_TREE->push(AST_TREE->add_char(char_at(t.lexeme, 0)));
                         }else if(t.token == Token::STRING_literal){
-                            parameters.push_back(new AST_string(t.lexeme));
-                            stringLiterals[t.lexeme] = "str_" + std::to_string(stringLiteralCounter++);
+                            symbol_id literal = SYMBOLS->intern(t.lexeme);
+                            AST_TREE->push(AST_TREE->add_string(literal));
+                            stringLiterals->add(literal);
                         }else if(t.token == Token::COMMA){
                             // Do nothing
                         }else{
@@ -383,7 +420,7 @@ AST_expression*     build_expression(std::queue<TokenData>& operand_queue) {
                         operand_queue.pop();
                     }
 
-                    node = new AST_function_call(temp.lexeme, parameters);
+                    node = AST_TREE->add_call(SYMBOLS->intern(temp.lexeme), parameters);
                     
                     break;
                 default:
@@ -397,16 +434,17 @@ AST_expression*     build_expression(std::queue<TokenData>& operand_queue) {
     }
 
     // The last node on the stack is the root of the AST
-    return ast_stack.empty() ? nullptr : ast_stack.top();
+    return ast_stack.empty() ? NO_NODE : ast_stack.top();
 }
 
 // PARSE: Block
 // - this parses a block of code
 // - similar to parse_program, but this is used for parsing blocks{...}
 // - this is used by parse_conditional,parse_loop and parse_function
-AST_expression* parse_block(std::string &code, int& index, bool is_function = false){
-    AST_block* block = new AST_block();
-    TokenData t = get_token(code, index);
+// - a function's body shares the scope of its parameters
+node_id parse_block(TokenStream& ts, bool is_function = false){
+    uint32_t children = AST_TREE->begin_list();
+    TokenData t = ts.advance();
 
     if(t.token != Token::OPEN_BRACE){
         // Error
@@ -416,69 +454,68 @@ AST_expression* parse_block(std::string &code, int& index, bool is_function = fa
     if(!is_function){
         SYMBOL_TABLE = SYMBOL_TABLE->scopeIn();
     }
+    Table* scope = SYMBOL_TABLE;
 
-    int copy_index = index;
-    TokenData td = get_token(code, copy_index);
+    TokenData td = ts.peek();
 
     while(td.token != Token::CLOSE_BRACE){
-        if(td.token == Token::NEW_LINE || td.token == Token::SEMICOLON || code[index] == ' ' || code[index] == '\t'){
-            index += 1;
-        }else if(td.token == Token::END_OF_FILE || code.size() <= index){
+        if(td.token == Token::NEW_LINE || td.token == Token::SEMICOLON){
+            ts.advance();
+        }else if(td.token == Token::END_OF_FILE){
             // Error
             throw std::runtime_error("Block missing close brace");
         }else if(td.token == Token::LET){ // Declaration found
-            block->addChild(parse_declaration(code, index));
+            AST_TREE->push(parse_declaration(ts));
         }else if (td.token == Token::IF){ // Conditional found
-            block->addChild(parse_conditional(code, index));
+            AST_TREE->push(parse_conditional(ts));
         }else if (td.token == Token::WHILE){ // Loop found
-            block->addChild(parse_loop(code, index));  
+            AST_TREE->push(parse_loop(ts));  
         }else if (td.token == Token::OPEN_BRACE){  // Scope found
-            block->addChild(parse_block(code, index, false));
+            AST_TREE->push(parse_block(ts, false));
         }else if (td.token == Token::RETURN){  // Return found;
-            block->addChild(parse_return(code, index));
+            AST_TREE->push(parse_return(ts));
         }else{
-            block->addChild(parse_expression(code, index, false));
+            AST_TREE->push(parse_expression(ts, false));
         }
 
-        copy_index = index;
-        td = get_token(code, copy_index);
+        td = ts.peek();
     }
 
     if(!is_function){
         SYMBOL_TABLE = SYMBOL_TABLE->scopeOut();
     }
 
-    index = copy_index;
-    // index++;
+    // consume the close brace
+    ts.advance();
 
-    return block;
+    return AST_TREE->add_block(children, scope);
 }
 
 //  PARSE: Function
 //  - this parses a function which starts with the keyword "fn"
 //  - this is used by parse_program ONLY (which means that functions cannot be nested)
-AST_expression* parse_function(std::string &code, int& index){
-    TokenData t = get_token(code, index);
+node_id parse_function(TokenStream& ts){
+    TokenData t = ts.advance();
     metadata function_data;
     function_data.is_function = true;
-    std::string function_name;
+    symbol_id function_name;
     if(t.token != Token::FUNCTION){
         // Error
         throw std::runtime_error("Function missing keyword fn");
     }
 
-    t = get_token(code, index);
+    t = ts.advance();
 
-    AST_function* function;
+    uint32_t parameters;
     if(t.token != Token::CALL){
         // Error
         throw std::runtime_error("Function missing name");
     }else{
-        function = new AST_function(t.lexeme);
-        function_name = t.lexeme;
+        function_name = SYMBOLS->intern(t.lexeme);
+        parameters = AST_TREE->begin_list();
     }
     
-    t = get_token(code, index);
+    t = ts.advance();
     if(t.token != Token::OPEN_PAREN){
         // Error
         throw std::runtime_error("Function missing open paren");
@@ -487,30 +524,28 @@ AST_expression* parse_function(std::string &code, int& index){
     SYMBOL_TABLE = SYMBOL_TABLE->scopeIn();
 
     while(t.token != Token::CLOSE_PAREN){
-        t = get_token(code, index);
+        t = ts.advance();
         if(t.token == Token::INT_literal){
-            function->addParameter(new AST_integer(std::stoi(t.lexeme)));
+            AST_TREE->push(AST_TREE->add_integer(lexeme_to_int(t.lexeme)));
         }else if(t.token == Token::FLOAT_literal){
-            function->addParameter(new AST_float(std::stof(t.lexeme)));
+            AST_TREE->push(AST_TREE->add_float(lexeme_to_float(t.lexeme)));
         }else if(t.token == Token::BOOL_literal){
-            function->addParameter(new AST_boolean(t.lexeme == "TRUE" ? true : false));
+            AST_TREE->push(AST_TREE->add_boolean(t.lexeme == "TRUE" ? true : false));
         }else if(t.token == Token::CHAR_literal){
-            function->addParameter(new AST_char(t.lexeme[0]));
+            AST_TREE->push(AST_TREE->add_char(char_at(t.lexeme, 0)));
         }else if(t.token == Token::STRING_literal){
-            function->addParameter(new AST_string(t.lexeme));
+            AST_TREE->push(AST_TREE->add_string(SYMBOLS->intern(t.lexeme)));
         }else if(t.token == Token::IDENTIFIER){
-            function->addParameter(new AST_variable(t.lexeme));
+            symbol_id name = SYMBOLS->intern(t.lexeme);
+            AST_TREE->push(AST_TREE->add_variable(name));
 
             // Add the parameter to the symbol table
             metadata data;
             data.type = data_type::UNKNOWN;
             data.size = 8;
-            std::string name = t.lexeme;
 
-            int copy_index = index;
-            TokenData td = get_token(code, copy_index);
-            if(td.token == Token::COLON){ // colon, expect data type
-                td = get_token(code, copy_index);
+            if(ts.peek().token == Token::COLON){ // colon, expect data type
+                TokenData td = ts.peek(1);
 
                 if(td.token == Token::INT){
                     // Parameter is an integer
@@ -536,7 +571,8 @@ AST_expression* parse_function(std::string &code, int& index){
                     // Error
                     throw std::runtime_error("Invalid parameter type");
                 }
-                index = copy_index;
+                ts.advance();
+                ts.advance();
             }
 
             SYMBOL_TABLE->addSymbol(name, data);
@@ -550,10 +586,8 @@ AST_expression* parse_function(std::string &code, int& index){
         }
     }
 
-    int copy_index = index;
-    TokenData td = get_token(code, copy_index);
-    if(td.token == Token::COLON){ // expect data type
-        td = get_token(code, copy_index);
+    if(ts.peek().token == Token::COLON){ // expect data type
+        TokenData td = ts.peek(1);
         if(td.token == Token::INT){
             // Return type is an integer
             function_data.type = data_type::INTEGER;
@@ -574,93 +608,91 @@ AST_expression* parse_function(std::string &code, int& index){
             throw std::runtime_error("Invalid return type");
         }
 
-        index = copy_index;
+        ts.advance();
+        ts.advance();
     }
 
-    function->setBody(dynamic_cast<AST_block*>(parse_block(code, index, true)));
+    AST_TREE->push(parse_block(ts, true));
     SYMBOL_TABLE = SYMBOL_TABLE->scopeOut();
     SYMBOL_TABLE->addSymbol(function_name, function_data);
-    return function;
+    return AST_TREE->add_function(function_name, parameters);
 }
 
 // PARSE: Conditional
 // - this parses a conditional which starts with the keyword "if"
-AST_expression* parse_conditional(std::string &code, int& index){
+// - each branch adds its condition, or NO_NODE for the last else, and its body
+node_id parse_conditional(TokenStream& ts){
     TokenData t;
-    AST_conditional* conditional = new AST_conditional();
+    uint32_t branches = AST_TREE->begin_list();
     bool elseFound = false;
 
-    while(t.token != Token::END_OF_FILE){
-        t = get_token(code, index);
-        if(t.token == Token::IF){
-            t = get_token(code, index);
+    while(ts.peek().token != Token::END_OF_FILE){
+        if(ts.peek().token == Token::IF){
+            ts.advance();
+            t = ts.advance();
             if(t.token != Token::OPEN_PAREN){
                 // Error
                 throw std::runtime_error("Conditional missing open paren");
             }
-            AST_expression* condition = parse_expression(code, index, true);
-            AST_block* body = dynamic_cast<AST_block*>(parse_block(code, index, false));
-            conditional->addBranch(condition, body);
+            AST_TREE->push(parse_expression(ts, true));
+            AST_TREE->push(parse_block(ts, false));
 
             if(elseFound){
                 elseFound = false;
             }
         }else if(elseFound){
             // last else
-            AST_block* body = dynamic_cast<AST_block*>(parse_block(code, index, false));
-            conditional->addBranch(nullptr, body);
+            AST_TREE->push(NO_NODE);
+            AST_TREE->push(parse_block(ts, false));
             break;
         }
         
-        int copy_index = index;
-        t = get_token(code, copy_index);
-        if(t.token != Token::ELSE){
+        if(ts.peek().token != Token::ELSE){
             break;
         }else{
             elseFound = true;
-            index = copy_index;
+            ts.advance();
         }
     }
     
-    return conditional;
+    return AST_TREE->add_conditional(branches);
 }
 
 //  PARSE: Loop
 //  - this parses a loop which starts with the keyword "while"
-AST_expression* parse_loop(std::string& code, int& index){
+node_id parse_loop(TokenStream& ts){
     TokenData t;
-    AST_loop* loop = new AST_loop();
-    t = get_token(code, index);
+    t = ts.advance();
     if(t.token != Token::WHILE){
         // Error
         throw std::runtime_error("Expected keyword WHILE in a loop");
     }
 
-    t = get_token(code, index);
+    t = ts.advance();
     if(t.token != Token::OPEN_PAREN){
         // Error
         throw std::runtime_error("Condition missing open paren");
     }
 
-    loop->condition  = parse_expression(code, index, true);
-    loop->body = dynamic_cast<AST_block*>(parse_block(code, index, false));
+    node_id condition = parse_expression(ts, true);
+    node_id body = parse_block(ts, false);
 
-    return loop;
+    return AST_TREE->add_loop(condition, body);
 }
 
 //  PARSE: Return
 //  - this parses a return statement
-AST_expression* parse_return(std::string& code, int& index){
+node_id parse_return(TokenStream& ts){
     TokenData t;
-    AST_expression* expr;
-    t = get_token(code, index);
+    node_id expr;
+    t = ts.advance();
     if(t.token != Token::RETURN){
         // Error
         throw std::runtime_error("Expected keyword RETURN");
     }
 
-    expr = parse_expression(code, index, false);
-    return new AST_return(expr);
+    expr = parse_expression(ts, false);
+    return AST_TREE->add_return(expr);
 }
 
 #endif
\ No newline at end of file
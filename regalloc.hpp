@@ -0,0 +1,363 @@
+#ifndef REGALLOC_HPP
+#define REGALLOC_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "x86.hpp"
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// SECTION : REGISTER ALLOCATION
+// - code generation writes virtual registers, linear scan then gives each one a register or a stack slot for all of its life
+// - a virtual register lives from its first to its last appearance, that is exact because each one holds a temporary
+//   of one statement, variables are in stack slots, so none is alive around the back edge of a loop
+// - instruction i reads at position 2i and writes at 2i + 1, a value read for the last time can share its register
+//   with the value the same instruction writes
+// - instructions that name a register or change one implicitly (cdq, idiv, calls into the runtime) block it at their
+//   position, a virtual register only gets a register that is not blocked anywhere in its life
+// - spilled values live in 8-byte slots at [rbp + 8 * slot], between the frame of the program and whatever is above it
+//-----------------------------------------------------------------------------------------------------------------------------
+
+// Registers handed to virtual registers, in order of preference
+const Reg ALLOCATABLE[] = {
+    Reg::R10, Reg::R12, Reg::R13, Reg::R14, Reg::R15, Reg::R8, Reg::R9,
+    Reg::RAX, Reg::RBX, Reg::RCX, Reg::RDX, Reg::RDI, Reg::RSI,
+};
+
+// Never allocated, carries spilled values through instructions that cannot take a stack slot as that operand
+const Reg SCRATCH = Reg::R11;
+
+// Registers a call into the runtime may change
+const Reg CALL_CLOBBERED[] = {Reg::RAX, Reg::RCX, Reg::RDX, Reg::RSI, Reg::RDI, Reg::R11};
+
+// SPILL AREA
+// - the sub rsp and add rsp around the program that reserve the spill slots, emitted with an immediate of 0
+// - indexes into the instruction list, they get the size of the slots or are dropped when nothing spills
+struct SpillArea{
+    uint32_t reserve;
+    uint32_t release;
+};
+
+// ALLOCATION STATISTICS
+struct AllocationStats{
+    uint32_t intervals = 0;     // virtual registers in use
+    uint32_t spilled = 0;       // of those, the ones living in a stack slot
+    uint32_t slots = 0;         // stack slots, spilled values that never live at the same time share one
+};
+
+// CLASS : Linear scan
+// - replaces every virtual register of an instruction list
+class LinearScan{
+public:
+    explicit LinearScan(InstrList& list) : list(list) {}
+
+    AllocationStats run(SpillArea area){
+        find_intervals();
+        assign();
+        rewrite(area);
+        return stats;
+    }
+
+private:
+    static const uint32_t NO_POSITION = UINT32_MAX;
+    static const uint32_t NO_SLOT = UINT32_MAX;
+
+    struct Interval{
+        uint32_t start = NO_POSITION;
+        uint32_t end = 0;
+        Reg reg = Reg::NONE;
+        uint32_t slot = NO_SLOT;
+    };
+
+    InstrList& list;
+    std::vector<Interval> intervals;        // by virtual register
+    std::vector<uint32_t> blocked[16];      // by register, positions in increasing order
+    AllocationStats stats;
+
+    // the first operand is read by all but plain moves, and written by all but compares, pushes and divisions
+    // the second operand is only ever read
+    static bool reads_a(Op op){
+        return op != Op::MOV && op != Op::MOVSX && op != Op::MOVSXD && op != Op::MOVZX && op != Op::LEA && op != Op::POP &&
+            op != Op::IMUL_IMM;
+    }
+
+    static bool writes_a(Op op){
+        return op != Op::CMP && op != Op::TEST && op != Op::PUSH && op != Op::IDIV && op != Op::DIV;
+    }
+
+    // rsp, rbp and SCRATCH are never handed out, so nothing needs to know where they are used
+    void block(Reg reg, uint32_t position){
+        if(reg == Reg::NONE || reg == Reg::RSP || reg == Reg::RBP || reg == SCRATCH){
+            return;
+        }
+        std::vector<uint32_t>& positions = blocked[(int)reg];
+        if(positions.empty() || positions.back() != position){
+            positions.push_back(position);
+        }
+    }
+
+    bool blocked_during(Reg reg, const Interval& interval) const {
+        const std::vector<uint32_t>& positions = blocked[(int)reg];
+        auto it = std::lower_bound(positions.begin(), positions.end(), interval.start);
+        return it != positions.end() && *it <= interval.end;
+    }
+
+    void touch(const Operand& o, uint32_t position){
+        if(o.is(Operand::Kind::VREG)){
+            Interval& interval = intervals[o.label];
+            interval.start = std::min(interval.start, position);
+            interval.end = std::max(interval.end, position);
+        }else if(o.is(Operand::Kind::REG)){
+            block(o.reg, position);
+        }
+    }
+
+    void find_intervals(){
+        intervals.assign(list.vregs, Interval());
+        for(uint32_t i = 0; i < (uint32_t)list.code.size(); i++){
+            const Instr& instr = list.code[i];
+            uint32_t use = 2 * i;
+            uint32_t def = 2 * i + 1;
+
+            // reads, the base of a memory operand is read whichever side it is on
+            if(instr.a.is(Operand::Kind::MEM)){
+                block(instr.a.reg, use);
+            }else if(reads_a(instr.op)){
+                touch(instr.a, use);
+            }
+            if(instr.b.is(Operand::Kind::MEM)){
+                block(instr.b.reg, use);
+            }else{
+                touch(instr.b, use);
+            }
+            switch(instr.op){
+                case Op::CDQ:
+                case Op::CQO:
+                    block(Reg::RAX, use);
+                    break;
+                case Op::IDIV:
+                case Op::DIV:
+                    block(Reg::RAX, use);
+                    block(Reg::RDX, use);
+                    break;
+                case Op::CALL:
+                    block(Reg::RDI, use);
+                    break;
+                case Op::SYSCALL:
+                    block(Reg::RAX, use);
+                    block(Reg::RDX, use);
+                    block(Reg::RSI, use);
+                    block(Reg::RDI, use);
+                    break;
+                default:
+                    break;
+            }
+
+            // writes
+            if(!instr.a.is(Operand::Kind::MEM) && writes_a(instr.op)){
+                touch(instr.a, def);
+            }
+            switch(instr.op){
+                case Op::CDQ:
+                case Op::CQO:
+                    block(Reg::RDX, def);
+                    break;
+                case Op::IDIV:
+                case Op::DIV:
+                    block(Reg::RAX, def);
+                    block(Reg::RDX, def);
+                    break;
+                case Op::CALL:
+                    for(Reg reg : CALL_CLOBBERED){
+                        block(reg, def);
+                    }
+                    break;
+                case Op::SYSCALL:
+                    block(Reg::RAX, def);
+                    block(Reg::RCX, def);
+                    block(Reg::R11, def);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    // FUNCTION : assign
+    // - intervals in order of their start, the ones holding a register or a slot are expired once they end
+    // - when no register fits, the interval that ends last gives up its register and lives in a slot
+    void assign(){
+        std::vector<uint32_t> order;
+        for(uint32_t v = 0; v < (uint32_t)intervals.size(); v++){
+            if(intervals[v].start != NO_POSITION){
+                order.push_back(v);
+            }
+        }
+        // code generation numbers virtual registers as it first writes them, so this is usually sorted already
+        auto byStart = [&](uint32_t x, uint32_t y){
+            return intervals[x].start < intervals[y].start;
+        };
+        if(!std::is_sorted(order.begin(), order.end(), byStart)){
+            std::stable_sort(order.begin(), order.end(), byStart);
+        }
+        stats.intervals = (uint32_t)order.size();
+
+        std::vector<uint32_t> active;           // holding a register
+        std::vector<uint32_t> activeSlots;      // holding a stack slot
+        std::vector<uint32_t> freeSlots;
+        bool taken[16] = {};
+
+        for(uint32_t v : order){
+            Interval& current = intervals[v];
+
+            for(size_t k = 0; k < active.size();){
+                const Interval& other = intervals[active[k]];
+                if(other.end < current.start){
+                    taken[(int)other.reg] = false;
+                    active[k] = active.back();
+                    active.pop_back();
+                }else{
+                    k++;
+                }
+            }
+            for(size_t k = 0; k < activeSlots.size();){
+                const Interval& other = intervals[activeSlots[k]];
+                if(other.end < current.start){
+                    freeSlots.push_back(other.slot);
+                    activeSlots[k] = activeSlots.back();
+                    activeSlots.pop_back();
+                }else{
+                    k++;
+                }
+            }
+
+            for(Reg reg : ALLOCATABLE){
+                if(!taken[(int)reg] && !blocked_during(reg, current)){
+                    current.reg = reg;
+                    taken[(int)reg] = true;
+                    active.push_back(v);
+                    break;
+                }
+            }
+            if(current.reg != Reg::NONE){
+                continue;
+            }
+
+            size_t victim = active.size();
+            for(size_t k = 0; k < active.size(); k++){
+                const Interval& other = intervals[active[k]];
+                if(other.end > current.end && !blocked_during(other.reg, current) &&
+                    (victim == active.size() || other.end > intervals[active[victim]].end)){
+                    victim = k;
+                }
+            }
+            uint32_t spilled = v;
+            if(victim != active.size()){
+                spilled = active[victim];
+                current.reg = intervals[spilled].reg;
+                intervals[spilled].reg = Reg::NONE;
+                active[victim] = v;
+            }
+
+            Interval& slotted = intervals[spilled];
+            if(freeSlots.empty()){
+                slotted.slot = stats.slots++;
+            }else{
+                slotted.slot = freeSlots.back();
+                freeSlots.pop_back();
+            }
+            activeSlots.push_back(spilled);
+            stats.spilled++;
+        }
+    }
+
+    // replaces a virtual register by its register or its slot, true for a slot
+    bool place(Operand& o) const {
+        if(!o.is(Operand::Kind::VREG)){
+            return false;
+        }
+        const Interval& interval = intervals[o.label];
+        if(interval.reg != Reg::NONE){
+            o = op_reg(interval.reg, o.size);
+            return false;
+        }
+        o = op_mem(Reg::RBP, 8 * (int64_t)interval.slot, o.size);
+        return true;
+    }
+
+    // a copy whose source and destination got the same register, like the one a && or || used as a value ends in
+    static bool self_move(const Instr& instr){
+        return instr.op == Op::MOV && instr.a.is(Operand::Kind::REG) && instr.b.is(Operand::Kind::REG) &&
+            instr.a.reg == instr.b.reg && instr.a.size == instr.b.size;
+    }
+
+    // FUNCTION : rewrite
+    // - a slot stands in for its register where x86 takes a memory operand, SCRATCH is loaded or stored around the rest:
+    //   a destination that must be a register, or two memory operands, label addresses and wide immediates with a slot
+    // - copies that became self moves are dropped
+    void rewrite(SpillArea area){
+        if(stats.spilled == 0){
+            // every operand is replaced where it is, only the spill area and the self moves go
+            for(Instr& instr : list.code){
+                place(instr.a);
+                place(instr.b);
+            }
+            list.code.erase(list.code.begin() + std::max(area.reserve, area.release));
+            list.code.erase(list.code.begin() + std::min(area.reserve, area.release));
+            list.code.erase(std::remove_if(list.code.begin(), list.code.end(), self_move), list.code.end());
+            return;
+        }
+
+        uint32_t spillBytes = (stats.slots * 8 + 15) / 16 * 16;
+        std::vector<Instr> code;
+        code.reserve(list.code.size() + 2 * stats.spilled);
+
+        for(uint32_t i = 0; i < (uint32_t)list.code.size(); i++){
+            Instr instr = list.code[i];
+            if(i == area.reserve || i == area.release){
+                if(spillBytes != 0){
+                    instr.b = op_imm(spillBytes);
+                    code.push_back(instr);
+                }
+                continue;
+            }
+
+            bool aSpilled = place(instr.a);
+            bool bSpilled = place(instr.b);
+            bool aNeedsRegister = instr.op == Op::IMUL || instr.op == Op::IMUL_IMM || instr.op == Op::MOVSX ||
+                instr.op == Op::MOVSXD || instr.op == Op::MOVZX || instr.op == Op::LEA;
+            bool bNeedsRegister = instr.b.is(Operand::Kind::MEM) || instr.b.is(Operand::Kind::LABEL) ||
+                (instr.b.is(Operand::Kind::IMM) && (instr.b.value < INT32_MIN || instr.b.value > INT32_MAX));
+
+            if(aSpilled && (aNeedsRegister || bNeedsRegister)){
+                Operand slot = instr.a;
+                slot.size = 8;
+                if(reads_a(instr.op)){
+                    code.push_back(Instr{Op::MOV, op_reg(SCRATCH), slot});
+                }
+                instr.a = op_reg(SCRATCH, instr.a.size);
+                code.push_back(instr);
+                if(writes_a(instr.op)){
+                    code.push_back(Instr{Op::MOV, slot, op_reg(SCRATCH)});
+                }
+            }else if(bSpilled && instr.a.is(Operand::Kind::MEM)){
+                Operand slot = instr.b;
+                slot.size = 8;
+                code.push_back(Instr{Op::MOV, op_reg(SCRATCH), slot});
+                instr.b = op_reg(SCRATCH, instr.b.size);
+                code.push_back(instr);
+            }else if(!self_move(instr)){
+                code.push_back(instr);
+            }
+        }
+        list.code.swap(code);
+    }
+};
+
+// FUNCTION : allocate registers
+AllocationStats allocate_registers(InstrList& list, SpillArea area){
+    return LinearScan(list).run(area);
+}
+
+#endif // REGALLOC_HPP
@@ -0,0 +1,126 @@
+#ifndef RESOLVE_HPP
+#define RESOLVE_HPP
+
+#include "ast.hpp"
+#include "table.hpp"
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// SECTION : NAME RESOLUTION
+// - binds every variable reference to its symbol table entry and computes its frame offset, both kept in the node
+// - runs once between parsing and code generation, so code generation does no lookups
+//-----------------------------------------------------------------------------------------------------------------------------
+
+class Resolver{
+private:
+    AST_program* program;
+    Table* table;       // any scope of the tree, lookups go through the shared index
+    int frame = 0;      // stack bytes allocated by the enclosing scopes, rbp - frame is rsp during codegen
+
+public:
+    Resolver(AST_program* program, Table* table) : program(program), table(table) {}
+
+    void resolve_program(){
+        frame = aligned_scope_size(table->scope_size);
+        for(node_id expr : program->expressions){
+            resolve(expr);
+        }
+        frame = 0;
+    }
+
+    void resolve(node_id node){
+        switch(program->type(node)){
+            case AST_type::INTEGER:
+            case AST_type::FLOAT:
+            case AST_type::BOOLEAN:
+            case AST_type::CHAR:
+            case AST_type::STRING:
+                break;
+            case AST_type::VARIABLE:
+                resolve_variable(node);
+                break;
+            case AST_type::UNARY:
+            case AST_type::RETURN:
+                resolve(program->operand(node));
+                break;
+            case AST_type::BINARY:
+                // same order as code generation, so the first reference is the declaring one
+                resolve(program->lhs(node));
+                resolve(program->rhs(node));
+                break;
+            case AST_type::BLOCK:
+                resolve_block(node);
+                break;
+            case AST_type::CONDITIONAL:
+                for(uint32_t i = 0; i < program->branches(node); i++){
+                    if(program->condition(node, i) != NO_NODE){
+                        resolve(program->condition(node, i));
+                    }
+                    resolve_block(program->body(node, i));
+                }
+                break;
+            case AST_type::LOOP:
+                resolve(program->condition(node));
+                resolve_block(program->body(node));
+                break;
+            case AST_type::FUNCTION:
+                resolve_function(node);
+                break;
+            case AST_type::FUNCTION_CALL:
+                for(node_id param : program->list(node)){
+                    resolve(param);
+                }
+                break;
+        }
+    }
+
+private:
+    void resolve_variable(node_id variable){
+        metadata& data = table->getVariable(program->name(variable));
+        if(data.relative_address == -1){ // Declaration
+            // the slot spans [rbp - frame + address, rbp - frame + address + size)
+            data.relative_address = frame - data.address;
+            data.variable = (uint32_t)program->variables.size();
+            program->variables.push_back(&data);
+        }
+        program->set_variable(variable, data.relative_address, data.variable);
+    }
+
+    void resolve_block(node_id block){
+        Table* scope = program->scope(block);
+        scope->showBindings();
+        frame += aligned_scope_size(scope->scope_size);
+        for(node_id child : program->list(block)){
+            resolve(child);
+        }
+        frame -= aligned_scope_size(scope->scope_size);
+        scope->hideBindings();
+    }
+
+    void resolve_function(node_id function){
+        // a function runs in its own frame, its body shares the scope of the parameters
+        node_id body = program->body(function);
+        Table* scope = program->scope(body);
+        int outerFrame = frame;
+        frame = aligned_scope_size(scope->scope_size);
+
+        scope->showBindings();
+        for(node_id param : program->list(function)){
+            resolve(param);
+        }
+        for(node_id child : program->list(body)){
+            resolve(child);
+        }
+        scope->hideBindings();
+
+        frame = outerFrame;
+    }
+};
+
+// FUNCTION : resolve
+// - annotates the whole program, the symbol table must be at the global scope
+void resolve(AST_program* program, Table* globals){
+    Resolver resolver(program, globals);
+    resolver.resolve_program();
+}
+
+#endif // RESOLVE_HPP
@@ -0,0 +1,141 @@
+#ifndef SCANNER_HPP
+#define SCANNER_HPP
+
+#include <cstddef>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ION_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// SECTION : SCANNING KERNELS
+// - used by the lexer to skip over runs of blanks, comment bodies and literal bodies
+// - SSE2/AVX2 versions look at 16/32 bytes per step, the best one is picked at runtime
+//-----------------------------------------------------------------------------------------------------------------------------
+
+// SCALAR KERNELS
+// - fallback for non-x86 targets and for the tail of the vector kernels
+
+// returns the offset of the first byte equal to a or b, or n if there is none
+inline size_t scan_until_scalar(const char* p, size_t n, char a, char b){
+    size_t i = 0;
+    while(i < n && p[i] != a && p[i] != b){
+        i++;
+    }
+    return i;
+}
+
+// returns the offset of the first byte that is not a space or a tab, or n if there is none
+inline size_t skip_blanks_scalar(const char* p, size_t n){
+    size_t i = 0;
+    while(i < n && (p[i] == ' ' || p[i] == '\t')){
+        i++;
+    }
+    return i;
+}
+
+#ifdef ION_SCAN_X86
+
+// SSE2 KERNELS
+__attribute__((target("sse2")))
+inline size_t scan_until_sse2(const char* p, size_t n, char a, char b){
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+    size_t i = 0;
+    for(; i + 16 <= n; i += 16){
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, va), _mm_cmpeq_epi8(chunk, vb)));
+        if(mask != 0){
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return i + scan_until_scalar(p + i, n - i, a, b);
+}
+
+__attribute__((target("sse2")))
+inline size_t skip_blanks_sse2(const char* p, size_t n){
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    size_t i = 0;
+    for(; i + 16 <= n; i += 16){
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, tab)));
+        if(mask != 0xFFFF){
+            return i + __builtin_ctz(~mask);
+        }
+    }
+    return i + skip_blanks_scalar(p + i, n - i);
+}
+
+// AVX2 KERNELS
+__attribute__((target("avx2")))
+inline size_t scan_until_avx2(const char* p, size_t n, char a, char b){
+    const __m256i va = _mm256_set1_epi8(a);
+    const __m256i vb = _mm256_set1_epi8(b);
+    size_t i = 0;
+    for(; i + 32 <= n; i += 32){
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, va), _mm256_cmpeq_epi8(chunk, vb)));
+        if(mask != 0){
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return i + scan_until_sse2(p + i, n - i, a, b);
+}
+
+__attribute__((target("avx2")))
+inline size_t skip_blanks_avx2(const char* p, size_t n){
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    size_t i = 0;
+    for(; i + 32 <= n; i += 32){
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, space), _mm256_cmpeq_epi8(chunk, tab)));
+        if(mask != 0xFFFFFFFFu){
+            return i + __builtin_ctz(~mask);
+        }
+    }
+    return i + skip_blanks_sse2(p + i, n - i);
+}
+
+#endif // ION_SCAN_X86
+
+// DISPATCH
+// - resolves the kernels once, on first use
+struct ScanKernels{
+    size_t (*scan_until)(const char*, size_t, char, char);
+    size_t (*skip_blanks)(const char*, size_t);
+};
+
+inline ScanKernels select_scan_kernels(){
+#ifdef ION_SCAN_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")){
+        return {scan_until_avx2, skip_blanks_avx2};
+    }
+    if(__builtin_cpu_supports("sse2")){
+        return {scan_until_sse2, skip_blanks_sse2};
+    }
+#endif
+    return {scan_until_scalar, skip_blanks_scalar};
+}
+
+inline const ScanKernels& scan_kernels(){
+    static const ScanKernels kernels = select_scan_kernels();
+    return kernels;
+}
+
+// FUNCTION : SCAN UNTIL
+// - offset of the first a or b in p[0..n), n if neither occurs
+inline size_t scan_until(const char* p, size_t n, char a, char b){
+    return scan_kernels().scan_until(p, n, a, b);
+}
+
+// FUNCTION : SKIP BLANKS
+// - offset of the first byte in p[0..n) that is not a space or a tab
+inline size_t skip_blanks(const char* p, size_t n){
+    return scan_kernels().skip_blanks(p, n);
+}
+
+#endif // SCANNER_HPP
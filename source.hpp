@@ -0,0 +1,116 @@
+#ifndef SOURCE_HPP
+#define SOURCE_HPP
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ION_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// SECTION : SOURCE LOADING
+//-----------------------------------------------------------------------------------------------------------------------------
+
+// CLASS : Source file
+// - read-only view of a source file, memory-mapped when the platform allows it
+// - falls back to reading the file into one buffer sized up front
+// - the view is not null-terminated
+class SourceFile{
+private:
+    const char* data = nullptr;
+    size_t length = 0;
+    bool mapped = false;
+    std::string buffer;
+
+    bool map(const char* path){
+#ifdef ION_HAS_MMAP
+        int fd = ::open(path, O_RDONLY);
+        if(fd < 0){
+            return false;
+        }
+
+        struct stat info;
+        if(fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size == 0){
+            ::close(fd);
+            return false;
+        }
+
+        void* address = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if(address == MAP_FAILED){
+            return false;
+        }
+        madvise(address, (size_t)info.st_size, MADV_SEQUENTIAL);
+
+        data = static_cast<const char*>(address);
+        length = (size_t)info.st_size;
+        mapped = true;
+        return true;
+#else
+        (void)path;
+        return false;
+#endif
+    }
+
+    bool read(const char* path){
+        std::FILE* file = std::fopen(path, "rb");
+        if(file == nullptr){
+            return false;
+        }
+
+        std::fseek(file, 0, SEEK_END);
+        long size = std::ftell(file);
+        std::fseek(file, 0, SEEK_SET);
+        if(size < 0){
+            std::fclose(file);
+            return false;
+        }
+
+        buffer.resize((size_t)size);
+        size_t got = size > 0 ? std::fread(&buffer[0], 1, (size_t)size, file) : 0;
+        std::fclose(file);
+        buffer.resize(got);
+
+        data = buffer.data();
+        length = buffer.size();
+        return true;
+    }
+
+public:
+    SourceFile() = default;
+    SourceFile(const SourceFile&) = delete;
+    SourceFile& operator=(const SourceFile&) = delete;
+
+    ~SourceFile(){
+#ifdef ION_HAS_MMAP
+        if(mapped){
+            munmap(const_cast<char*>(data), length);
+        }
+#endif
+    }
+
+    // Method to load a file, returns false if it cannot be opened
+    bool open(const char* path){
+        return map(path) || read(path);
+    }
+
+    std::string_view view() const {
+        return std::string_view(data, length);
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+    bool is_mapped() const {
+        return mapped;
+    }
+};
+
+#endif // SOURCE_HPP
@@ -1,10 +1,16 @@
 #ifndef TABLE_HPP
 #define TABLE_HPP
 
+#include <cstdint>
 #include <iostream>
 #include <unordered_map>
 #include <list>
+#include <deque>
 #include <map>
+#include <string>
+#include <vector>
+
+#include "intern.hpp"
 
 // DATA TYPES
 enum class data_type{
@@ -14,21 +20,59 @@ enum class data_type{
 // METADATA
 // This is a struct that stores the metadata of each variable
 struct metadata{
-    data_type type;
-    bool is_function;
-    int size;
-    int address;
+    data_type type = data_type::UNKNOWN;
+    bool is_function = false;
+    int size = 0;
+    int address = 0;
     int relative_address = -1;
+    uint32_t variable = UINT32_MAX;     // index into the variables of the resolved program, set with relative_address
+};
+
+// BINDING
+// This is a declaration of a name in one scope
+struct binding{
+    symbol_id name;
+    metadata data;
+    binding* shadowed = nullptr;    // binding of the same name that this one hides, if any
+};
+
+// SYMBOL INDEX
+// This maps every name to the innermost binding currently in scope
+// - symbol IDs are dense, so the index is a direct-mapped array and a lookup is one load
+// - each name's bindings form a stack through binding::shadowed
+class SymbolIndex{
+private:
+    std::vector<binding*> active;
+
+public:
+    binding* lookup(symbol_id name) const {
+        return name < active.size() ? active[name] : nullptr;
+    }
+
+    void push(binding* b){
+        if(b->name >= active.size()){
+            active.resize(b->name + 1, nullptr);
+        }
+        b->shadowed = active[b->name];
+        active[b->name] = b;
+    }
+
+    void pop(binding* b){
+        active[b->name] = b->shadowed;
+    }
 };
 
 // SCOPE
 // This is a tree structure that stores the scope of each variable  (e.g. global, function, block)
+// - lookups go through the index shared by the whole tree, not through the parent chain
+// - entering a scope pushes its bindings into the index and leaving pops them, O(names declared in the scope)
 class Table{
 public:
     int scope_size;
-    std::unordered_map <std::string, metadata> symbol_table;
+    std::deque <binding> bindings;      // in declaration order, deque keeps references stable
     Table* parent;
     std::list <Table*> children;
+    SymbolIndex* index;
 
     // Iterator to keep track of the current child
     std::list<Table*>::iterator currentChild;
@@ -36,9 +80,23 @@ public:
     Table(Table* parent = nullptr){
         this->scope_size = 0;
         this->parent = parent;
+        this->index = parent != nullptr ? parent->index : new SymbolIndex();
         this->currentChild = children.end();
     }
 
+    Table(const Table&) = delete;
+    Table& operator=(const Table&) = delete;
+
+    // The global scope owns the whole tree and its index
+    ~Table(){
+        for (Table* child : children) {
+            delete child;
+        }
+        if (parent == nullptr) {
+            delete index;
+        }
+    }
+
     // Method to add a new scope
     Table* scopeIn() {
         Table* newScope = new Table(this);
@@ -49,6 +107,7 @@ public:
     // Method to move to the outer scope
     Table* scopeOut() {
         if (parent != nullptr) {
+            hideBindings();
             return parent;
         } else {
             // Already at the global scope or no parent scope exists.
@@ -71,6 +130,7 @@ public:
                 throw std::runtime_error("No more child scopes to traverse into.");
             }
         }
+        (*currentChild)->showBindings();
         return *currentChild;
     }
 
@@ -79,6 +139,7 @@ public:
         if (parent != nullptr) {
             // Reset the current child iterator
             currentChild = children.end();
+            hideBindings();
             return parent;
         } else {
             throw std::runtime_error("No parent scope to move back to.");
@@ -86,81 +147,118 @@ public:
     }
 
     // Helper method to check if a variable exists in any parent scope
-    bool isVariableExists(const std::string& name) {
-        for (Table* current = this; current != nullptr; current = current->parent) {
-            if (current->symbol_table.find(name) != current->symbol_table.end()) {
-                return true;
-            }
-        }
-        return false;
+    bool isVariableExists(symbol_id name) {
+        return index->lookup(name) != nullptr;
     }
 
     // Method to add a variable
-    void addSymbol(const std::string& name, metadata& data) {
+    void addSymbol(symbol_id name, metadata& data) {
         if (!isVariableExists(name)) {
-            // if(data.type == data_type::UNKNOWN){
-            //     data.address = -1;
-            //     symbol_table[name] = data;
-            // }else{
             data.address = scope_size;
             scope_size += data.size;
-            symbol_table[name] = data;
-            // }
+            bindings.push_back(binding{name, data});
+            index->push(&bindings.back());
         } else {
-            throw std::runtime_error("Variable already exists: " + name);
+            throw std::runtime_error("Variable already exists: " + std::string(SYMBOLS->name(name)));
         }
     }
 
     // Method to get a variable
-    metadata& getVariable(const std::string& name) {
-        for (Table* current = this; current != nullptr; current = current->parent) {
-            auto it = current->symbol_table.find(name);
-            if (it != current->symbol_table.end()) {
-                return it->second;
-            }
+    metadata& getVariable(symbol_id name) {
+        binding* b = index->lookup(name);
+        if (b != nullptr) {
+            return b->data;
         }
-        throw std::runtime_error("Variable not found: " + name);
+        throw std::runtime_error("Variable not found: " + std::string(SYMBOLS->name(name)));
     }
 
     // Method to set the relative address of a variable
-    void set_relativeAddress(std::string name, int relativeAddress) {
-        for (Table* current = this; current != nullptr; current = current->parent) {
-            auto it = current->symbol_table.find(name);
-            if (it != current->symbol_table.end()) {
-                it->second.relative_address = relativeAddress;
-                return;
-            }
+    void set_relativeAddress(symbol_id name, int relativeAddress) {
+        binding* b = index->lookup(name);
+        if (b != nullptr) {
+            b->data.relative_address = relativeAddress;
+            return;
         }
-        throw std::runtime_error("Variable not found for setting relative address: " + name);
+        throw std::runtime_error("Variable not found for setting relative address: " + std::string(SYMBOLS->name(name)));
     }
 
     // Debugging purposes only
-    void printSymbolTable(int indent = 0) const {
-        if(indent == 0) std::cout << "Symbol Table:" << std::endl;
+    void printSymbolTable(std::ostream& os, int indent = 0) const {
+        if(indent == 0) os << "Symbol Table:\n";
         std::string indentStr(indent, ' ');  // Create an indentation string
 
-        std::cout << indentStr << "Scope Size: " << scope_size << std::endl;
+        os << indentStr << "Scope Size: " << scope_size << "\n";
 
-        for (const auto& pair : symbol_table) {
-            std::cout << indentStr << pair.first << ": Type=" << static_cast<int>(pair.second.type) 
-                    << ", Size=" << pair.second.size << ", Address=" << pair.second.address << std::endl;
+        for (const binding& b : bindings) {
+            os << indentStr << SYMBOLS->name(b.name) << ": Type=" << static_cast<int>(b.data.type) 
+                    << ", Size=" << b.data.size << ", Address=" << b.data.address << "\n";
         }
 
         for (Table* child : children) {
-            child->printSymbolTable(indent + 4);  // Increase indent for nested scopes
-            std::cout << std::endl;
+            child->printSymbolTable(os, indent + 4);  // Increase indent for nested scopes
+            os << "\n";
+        }
+    }
+
+    // Make this scope's bindings visible
+    void showBindings(){
+        for (binding& b : bindings) {
+            index->push(&b);
+        }
+    }
+
+    // Remove this scope's bindings from view, innermost first
+    void hideBindings(){
+        for (auto it = bindings.rbegin(); it != bindings.rend(); ++it) {
+            index->pop(&*it);
         }
     }
-    
 };
 
-// GLOBAL SYMBOL TABLE
-Table* SYMBOL_TABLE = new Table(nullptr);
+// FUNCTION : aligned scope size
+// - stack space reserved for a scope, kept 16-byte aligned
+inline int aligned_scope_size(int scope_size){
+    return (scope_size + 15) & ~15;
+}
+
+// CURRENT SCOPE
+// - starts at the global scope of the compilation running on this thread, the parser moves it in and out
+thread_local Table* SYMBOL_TABLE = nullptr;
 
-// Map to hold string literals and their corresponding labels
-std::map<std::string, std::string> stringLiterals;
+// STRING LITERALS
+// - every distinct literal gets one label, numbered in order of first appearance
+class StringLiteralTable{
+public:
+    std::vector<symbol_id> literals;                // label number -> literal
+    std::unordered_map<symbol_id, int> labels;      // literal -> label number
+
+    // Method to add a literal, returns its label number
+    int add(symbol_id literal){
+        auto it = labels.find(literal);
+        if(it != labels.end()){
+            return it->second;
+        }
+        int label = (int)literals.size();
+        literals.push_back(literal);
+        labels.emplace(literal, label);
+        return label;
+    }
+
+    bool contains(symbol_id literal) const {
+        return labels.find(literal) != labels.end();
+    }
+
+    // Method to get the assembly label of a literal
+    std::string label(symbol_id literal) const {
+        auto it = labels.find(literal);
+        if(it == labels.end()){
+            throw std::runtime_error("String literal not found in stringLiterals");
+        }
+        return "str_" + std::to_string(it->second);
+    }
+};
 
-// String literal counter
-int stringLiteralCounter = 0;
+// Table to hold string literals and their corresponding labels, for the compilation running on this thread
+thread_local StringLiteralTable* stringLiterals = nullptr;
 
 #endif
\ No newline at end of file
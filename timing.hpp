@@ -0,0 +1,205 @@
+#ifndef TIMING_HPP
+#define TIMING_HPP
+
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <new>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ION_HAS_RUSAGE 1
+#include <sys/resource.h>
+#endif
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// SECTION : ALLOCATION COUNTER
+// - the global operator new is replaced so every heap allocation on a thread is counted
+// - the counter is thread-local, so files compiled in parallel do not see each other's allocations
+//-----------------------------------------------------------------------------------------------------------------------------
+
+thread_local long long ALLOCATIONS = 0;
+
+// GCC cannot see that the replaced new and delete below are a matching pair
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(std::size_t size){
+    ALLOCATIONS++;
+    if(void* p = std::malloc(size ? size : 1)){
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size){
+    return ::operator new(size);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// SECTION : TIME REPORT
+//-----------------------------------------------------------------------------------------------------------------------------
+
+// FUNCTION : thread cpu ms
+// - CPU time of the calling thread, process CPU time where threads cannot be told apart
+inline double thread_cpu_ms(){
+#ifdef CLOCK_THREAD_CPUTIME_ID
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+#else
+    return std::clock() * 1000.0 / CLOCKS_PER_SEC;
+#endif
+}
+
+// FUNCTION : peak rss kb
+// - high-water mark of the resident set of the whole process, 0 where it is not available
+inline long peak_rss_kb(){
+#ifdef ION_HAS_RUSAGE
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;  // bytes on macOS
+#else
+    return usage.ru_maxrss;
+#endif
+#else
+    return 0;
+#endif
+}
+
+// PHASE
+// - measurements of one compiler stage
+struct Phase{
+    const char* name;
+    double wallMs = 0;
+    double cpuMs = 0;
+    long peakRssDeltaKb = 0;
+    long long allocations = 0;
+    long long items = 0;        // bytes, tokens or nodes the phase went through
+    const char* unit = "";
+
+    double rate() const {
+        return wallMs > 0 ? items / (wallMs / 1000.0) : 0.0;
+    }
+};
+
+// CLASS : Time report
+// - brackets each stage of a compilation with begin and end, does nothing when disabled
+// - peak RSS is per process, so with -j a phase's delta includes whatever the other workers grew by
+class TimeReport{
+public:
+    enum class Format{ NONE, TEXT, JSON };
+
+    Format format;
+    std::vector<Phase> phases;
+
+    TimeReport(Format format = Format::NONE) : format(format) {}
+
+    bool enabled() const {
+        return format != Format::NONE;
+    }
+
+    // Method to start timing a phase
+    void begin(const char* name){
+        if(!enabled()) return;
+        current = Phase{name};
+        startRss = peak_rss_kb();
+        startAllocations = ALLOCATIONS;
+        startCpu = thread_cpu_ms();
+        startWall = std::chrono::steady_clock::now();
+    }
+
+    // Method to finish the phase started last, items is how much it processed
+    void end(long long items, const char* unit){
+        if(!enabled()) return;
+        std::chrono::duration<double, std::milli> wall = std::chrono::steady_clock::now() - startWall;
+        current.wallMs = wall.count();
+        current.cpuMs = thread_cpu_ms() - startCpu;
+        current.allocations = ALLOCATIONS - startAllocations;
+        current.peakRssDeltaKb = peak_rss_kb() - startRss;
+        current.items = items;
+        current.unit = unit;
+        phases.push_back(current);
+    }
+
+    void print(std::ostream& os, const std::string& file) const {
+        if(format == Format::TEXT){
+            print_text(os, file);
+        }else if(format == Format::JSON){
+            print_json(os, file);
+        }
+    }
+
+private:
+    Phase current{""};
+    std::chrono::steady_clock::time_point startWall;
+    double startCpu = 0;
+    long startRss = 0;
+    long long startAllocations = 0;
+
+    void print_text(std::ostream& os, const std::string& file) const {
+        os << "Time report: " << file << "\n";
+        os << std::left << std::setw(10) << "  phase" << std::right
+           << std::setw(12) << "wall ms" << std::setw(12) << "cpu ms" << std::setw(14) << "peak RSS +KB"
+           << std::setw(12) << "allocs" << "  throughput\n";
+
+        Phase total{"total"};
+        for(const Phase& phase : phases){
+            print_row(os, phase);
+            total.wallMs += phase.wallMs;
+            total.cpuMs += phase.cpuMs;
+            total.peakRssDeltaKb += phase.peakRssDeltaKb;
+            total.allocations += phase.allocations;
+        }
+        print_row(os, total);
+    }
+
+    static void print_row(std::ostream& os, const Phase& phase){
+        os << "  " << std::left << std::setw(8) << phase.name << std::right << std::fixed << std::setprecision(3)
+           << std::setw(12) << phase.wallMs << std::setw(12) << phase.cpuMs
+           << std::setw(14) << phase.peakRssDeltaKb << std::setw(12) << phase.allocations;
+        if(phase.unit[0] != '\0'){
+            os << "  " << std::setprecision(0) << phase.rate() << " " << phase.unit << "/s";
+        }
+        os << std::defaultfloat << std::setprecision(6) << "\n";
+    }
+
+    // one JSON object per file and line, so reports of several files can be streamed
+    void print_json(std::ostream& os, const std::string& file) const {
+        os << "{\"file\":\"";
+        for(char c : file){
+            if(c == '"' || c == '\\') os << '\\';
+            os << c;
+        }
+        os << "\",\"phases\":[";
+        for(size_t i = 0; i < phases.size(); i++){
+            const Phase& phase = phases[i];
+            os << (i ? "," : "") << "{\"name\":\"" << phase.name << "\""
+               << ",\"wall_ms\":" << phase.wallMs
+               << ",\"cpu_ms\":" << phase.cpuMs
+               << ",\"peak_rss_delta_kb\":" << phase.peakRssDeltaKb
+               << ",\"allocations\":" << phase.allocations
+               << ",\"items\":" << phase.items
+               << ",\"unit\":\"" << phase.unit << "\""
+               << ",\"per_second\":" << phase.rate() << "}";
+        }
+        os << "]}\n";
+    }
+};
+
+#endif // TIMING_HPP
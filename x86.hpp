@@ -0,0 +1,292 @@
+#ifndef X86_HPP
+#define X86_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "emitter.hpp"
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// SECTION : X86-64 INSTRUCTIONS
+// - code generation builds a list of instructions, which is then printed as FASM text or encoded to machine code
+//-----------------------------------------------------------------------------------------------------------------------------
+
+// REGISTERS
+// - numbered as in the instruction encoding, the high bit of the number goes into the REX prefix
+enum class Reg : uint8_t {
+    RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15,
+    NONE = 0xFF
+};
+
+// FUNCTION : register name
+// - name of the low size bytes of a register
+const char* register_name(Reg reg, int size){
+    static const char* const names[4][16] = {
+        {"rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi", "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"},
+        {"eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi", "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d"},
+        {"ax", "cx", "dx", "bx", "sp", "bp", "si", "di", "r8w", "r9w", "r10w", "r11w", "r12w", "r13w", "r14w", "r15w"},
+        {"al", "cl", "dl", "bl", "spl", "bpl", "sil", "dil", "r8b", "r9b", "r10b", "r11b", "r12b", "r13b", "r14b", "r15b"},
+    };
+    int row = size == 8 ? 0 : size == 4 ? 1 : size == 2 ? 2 : 3;
+    return names[row][(int)reg];
+}
+
+// OPERAND
+// - a register, an immediate, a memory operand [base + displacement] or the address of a label
+// - or a virtual register, which code generation uses and register allocation replaces by a register or a stack slot
+struct Operand{
+    enum class Kind : uint8_t { NONE, REG, IMM, MEM, LABEL, VREG };
+
+    Kind kind = Kind::NONE;
+    uint8_t size = 8;       // bytes read or written, 0 for a memory operand that is only an address (lea)
+    Reg reg = Reg::NONE;    // the register, or the base of a memory operand
+    uint32_t label = 0;     // label ID, or the number of a virtual register
+    int64_t value = 0;      // immediate value, or displacement of a memory operand
+
+    bool is(Kind k) const {
+        return kind == k;
+    }
+};
+
+inline Operand op_reg(Reg reg, int size = 8){
+    Operand o;
+    o.kind = Operand::Kind::REG;
+    o.size = (uint8_t)size;
+    o.reg = reg;
+    return o;
+}
+
+inline Operand op_imm(int64_t value){
+    Operand o;
+    o.kind = Operand::Kind::IMM;
+    o.value = value;
+    return o;
+}
+
+inline Operand op_mem(Reg base, int64_t displacement, int size){
+    Operand o;
+    o.kind = Operand::Kind::MEM;
+    o.size = (uint8_t)size;
+    o.reg = base;
+    o.value = displacement;
+    return o;
+}
+
+inline Operand op_vreg(uint32_t vreg, int size = 8){
+    Operand o;
+    o.kind = Operand::Kind::VREG;
+    o.size = (uint8_t)size;
+    o.label = vreg;
+    return o;
+}
+
+inline Operand op_label(uint32_t label){
+    Operand o;
+    o.kind = Operand::Kind::LABEL;
+    o.label = label;
+    return o;
+}
+
+// OPCODES
+// - the subset code generation and the ELF64 runtime use, LABEL marks a position in the list
+enum class Op : uint8_t {
+    MOV, MOVSX, MOVSXD, MOVZX, LEA,
+    ADD, SUB, IMUL, IMUL_IMM, IDIV, DIV, CDQ, CQO, NEG, AND, XOR, TEST, CMP, INC, DEC,
+    SHL, SHR, SAR,
+    SETE, SETNE, SETL, SETLE, SETG, SETGE,
+    PUSH, POP, CALL, RET, SYSCALL,
+    JMP, JE, JNZ, JNS, JL, JLE, JG, JGE,
+    LABEL,
+};
+
+const char* mnemonic(Op op){
+    switch(op){
+        case Op::MOV: return "mov";
+        case Op::MOVSX: return "movsx";
+        case Op::MOVSXD: return "movsxd";
+        case Op::MOVZX: return "movzx";
+        case Op::LEA: return "lea";
+        case Op::ADD: return "add";
+        case Op::SUB: return "sub";
+        case Op::IMUL: return "imul";
+        case Op::IMUL_IMM: return "imul";
+        case Op::IDIV: return "idiv";
+        case Op::DIV: return "div";
+        case Op::CDQ: return "cdq";
+        case Op::CQO: return "cqo";
+        case Op::NEG: return "neg";
+        case Op::AND: return "and";
+        case Op::XOR: return "xor";
+        case Op::TEST: return "test";
+        case Op::CMP: return "cmp";
+        case Op::INC: return "inc";
+        case Op::DEC: return "dec";
+        case Op::SHL: return "shl";
+        case Op::SHR: return "shr";
+        case Op::SAR: return "sar";
+        case Op::SETE: return "sete";
+        case Op::SETNE: return "setne";
+        case Op::SETL: return "setl";
+        case Op::SETLE: return "setle";
+        case Op::SETG: return "setg";
+        case Op::SETGE: return "setge";
+        case Op::PUSH: return "push";
+        case Op::POP: return "pop";
+        case Op::CALL: return "call";
+        case Op::RET: return "ret";
+        case Op::SYSCALL: return "syscall";
+        case Op::JMP: return "jmp";
+        case Op::JE: return "je";
+        case Op::JNZ: return "jnz";
+        case Op::JNS: return "jns";
+        case Op::JL: return "jl";
+        case Op::JLE: return "jle";
+        case Op::JG: return "jg";
+        case Op::JGE: return "jge";
+        case Op::LABEL: return "";
+    }
+    return "";
+}
+
+// INSTRUCTION
+struct Instr{
+    Op op;
+    Operand a;                  // destination, or the only operand
+    Operand b;                  // source
+    uint32_t note = 0;          // comment for the listing, offset and length in InstrList::notes
+    uint32_t noteLength = 0;
+    int32_t immediate = 0;      // third operand, of IMUL_IMM: a = b * immediate
+};
+
+// CLASS : Instruction list
+// - the code of one program, with its labels and the bytes of its data segment
+class InstrList{
+public:
+    struct Label{
+        std::string name;
+        bool data;              // data labels are addresses in the data segment, the others are positions in the code
+        uint32_t offset;        // offset in the data segment
+    };
+
+    std::vector<Instr> code;
+    std::vector<Label> labels;
+    std::string data;
+    std::string notes;
+    uint32_t vregs = 0;         // virtual registers handed out
+
+    void clear(){
+        code.clear();
+        labels.clear();
+        data.clear();
+        notes.clear();
+        vregs = 0;
+    }
+
+    uint32_t new_vreg(){
+        return vregs++;
+    }
+
+    // Method to declare a code label, place it with place()
+    uint32_t new_label(std::string name){
+        labels.push_back(Label{std::move(name), false, 0});
+        return (uint32_t)labels.size() - 1;
+    }
+
+    // Method to declare a data label for bytes appended to the data segment
+    uint32_t new_data(std::string name, std::string_view bytes){
+        labels.push_back(Label{std::move(name), true, (uint32_t)data.size()});
+        data.append(bytes.data(), bytes.size());
+        return (uint32_t)labels.size() - 1;
+    }
+
+    void emit(Op op, Operand a = Operand(), Operand b = Operand()){
+        code.push_back(Instr{op, a, b});
+    }
+
+    void emit(Op op, Operand a, Operand b, int32_t immediate){
+        code.push_back(Instr{op, a, b});
+        code.back().immediate = immediate;
+    }
+
+    void place(uint32_t label){
+        emit(Op::LABEL, op_label(label));
+    }
+
+    // Method to attach a comment to the last instruction
+    void note(std::string_view text){
+        code.back().note = (uint32_t)notes.size();
+        code.back().noteLength = (uint32_t)text.size();
+        notes.append(text.data(), text.size());
+    }
+
+    std::string_view note_of(const Instr& instr) const {
+        return std::string_view(notes).substr(instr.note, instr.noteLength);
+    }
+};
+
+//-----------------------------------------------------------------------------------------------------------------------------
+// SECTION : FASM TEXT
+//-----------------------------------------------------------------------------------------------------------------------------
+
+void print_operand(const InstrList& list, const Operand& o, AsmEmitter& out){
+    switch(o.kind){
+        case Operand::Kind::NONE:
+            break;
+        case Operand::Kind::REG:
+            out << register_name(o.reg, o.size);
+            break;
+        case Operand::Kind::IMM:
+            out << o.value;
+            break;
+        case Operand::Kind::LABEL:
+            out << list.labels[o.label].name;
+            break;
+        case Operand::Kind::VREG:
+            out << "v" << o.label;
+            if(o.size != 8) out << ":" << (int)o.size;
+            break;
+        case Operand::Kind::MEM:
+            if(o.size == 1) out << "byte ";
+            else if(o.size == 2) out << "word ";
+            else if(o.size == 4) out << "dword ";
+            else if(o.size == 8) out << "qword ";
+            out << "[" << register_name(o.reg, 8);
+            if(o.value > 0) out << " + " << o.value;
+            else if(o.value < 0) out << " - " << -o.value;
+            out << "]";
+            break;
+    }
+}
+
+// FUNCTION : print fasm
+// - writes the instructions as FASM source, one per line
+void print_fasm(const InstrList& list, AsmEmitter& out){
+    for(const Instr& instr : list.code){
+        if(instr.op == Op::LABEL){
+            out << list.labels[instr.a.label].name << ":\n";
+            continue;
+        }
+
+        out << "    " << mnemonic(instr.op);
+        if(!instr.a.is(Operand::Kind::NONE)){
+            out << " ";
+            print_operand(list, instr.a, out);
+        }
+        if(!instr.b.is(Operand::Kind::NONE)){
+            out << ", ";
+            print_operand(list, instr.b, out);
+        }
+        if(instr.op == Op::IMUL_IMM){
+            out << ", " << instr.immediate;
+        }
+        if(instr.noteLength > 0){
+            out << "  ; " << list.note_of(instr);
+        }
+        out << "\n";
+    }
+}
+
+#endif // X86_HPP